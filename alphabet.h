@@ -0,0 +1,42 @@
+#ifndef _ALPHABET_H_
+#define _ALPHABET_H_
+
+/* Alfabet, z którego składają się historie. Jego rozmiar jest ustalany
+ * podczas kompilacji (np. -DALPHABET_SIZE=16) i wynosi od 2 do 16.
+ * Kolejnymi symbolami są cyfry '0' .. '9', a po nich litery 'A' .. 'F'.
+ *
+ * Parser zapisuje historie w postaci zakodowanej: każdy symbol zostaje
+ * zamieniony na numer syna w drzewie powiększony o 1 (tak, aby w historii
+ * nie pojawił się znak o kodzie 0), więc drzewo nie musi już sprawdzać,
+ * jakim znakiem jest symbol.
+ *
+ * Historie celowo nie są pakowane (po kilka symboli w bajcie): istnieją
+ * tylko do końca jednego polecenia, a w drzewie symbol i tak jest krawędzią,
+ * nie bajtem. Pakowanie zmniejszyłoby jedynie bufor linii parsera,
+ * kosztem przesunięć i masek przy każdym kroku w find_node().
+ */
+
+#ifndef ALPHABET_SIZE
+#define ALPHABET_SIZE 4
+#endif
+
+#if ALPHABET_SIZE < 2 || ALPHABET_SIZE > 16
+#error "ALPHABET_SIZE must be between 2 and 16"
+#endif
+
+#if ALPHABET_SIZE <= 10
+#define IS_SYMBOL(ch) ((ch) >= '0' && (ch) < '0' + ALPHABET_SIZE)
+#define SYMBOL_INDEX(ch) ((ch) - '0')
+#define SYMBOL_CHAR(index) ('0' + (index))
+#else
+#define IS_SYMBOL(ch) (((ch) >= '0' && (ch) <= '9') \
+	|| ((ch) >= 'A' && (ch) < 'A' + ALPHABET_SIZE - 10))
+#define SYMBOL_INDEX(ch) ((ch) <= '9' ? (ch) - '0' : (ch) - 'A' + 10)
+#define SYMBOL_CHAR(index) ((index) < 10 ? '0' + (index) : 'A' + (index) - 10)
+#endif
+
+// zamiana symbolu na jego postać zakodowaną i z powrotem na numer syna
+#define ENCODE_SYMBOL(ch) (SYMBOL_INDEX(ch) + 1)
+#define DECODE_SYMBOL(code) ((code) - 1)
+
+#endif /* _ALPHABET_H_ */
@@ -0,0 +1,73 @@
+/* Wykonywanie poleceń. Wczytuje kolejne polecenia parserem
+ * i przekazuje je do obsłużenia przez drzewo trie.
+ * Wspólne dla programu (quantization.c) i testów (fuzz.c).
+ */
+
+#include <stdbool.h>
+
+#include "commands.h"
+#include "parser.h"
+#include "trie_tree.h"
+#include "io.h"
+
+// Wykonuje polecenia do końca wejścia (lub do błędnej ostatniej linii).
+void execute_commands(void) {
+	while (true) {
+		Command command = read_line();
+		
+		switch (command.name) {
+			case EOF_ERROR:
+			io_error();
+			return;
+			
+			case EOF_CORRECT:;
+			return;
+			
+			case ERROR:
+			io_error();
+			break;
+			
+			case DECLARE:
+			declare(command.arg1);
+			break;
+			
+			case REMOVE:
+			Remove(command.arg1);
+			break;
+			
+			case VALID:
+			valid(command.arg1);
+			break;
+			
+			case ENERGY_CHK:
+			energy_chk(command.arg1);
+			break;
+			
+			case ENERGY_MOD:
+			energy_mod(command.arg1, command.arg2_ll);
+			break;
+			
+			case EQUAL:
+			equal(command.arg1, command.arg2_s);
+			break;
+			
+			case COUNT:
+			count(command.arg1);
+			break;
+			
+			case STATS:
+			stats(command.arg1);
+			break;
+			
+			case CLASS:
+			class_size(command.arg1);
+			break;
+			
+			case MEMBERS:
+			class_members(command.arg1);
+			break;
+			
+			case NONE: ;
+		}
+	}
+}
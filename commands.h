@@ -0,0 +1,6 @@
+#ifndef _COMMANDS_H_
+#define _COMMANDS_H_
+
+extern void execute_commands(void);
+
+#endif /* _COMMANDS_H_ */
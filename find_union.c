@@ -12,21 +12,32 @@
  *
  * Struktura przechowuje również informacje o energii i zrównaniach energii
  * i wyłapuje odpowiednie błędy z tym związane.
+ *
+ * Stosy wolnych identyfikatorów i numerów zbiorów mają zawsze pojemność
+ * równą pojemności odpowiednich tablic, więc usuwanie elementów nigdy
+ * nie wymaga przydzielania pamięci. Operacje, które jej wymagają,
+ * w razie jej braku zgłaszają błąd, nie zmieniając struktury.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include <inttypes.h>
 #include "find_union.h"
+#include "memory.h"
 
-#define CREATE(array, size) do { \
-	array = malloc(size); \
-	if (array == NULL) _Exit(1); \
+// W razie braku pamięci makra wykonują instrukcję on_error,
+// pozostawiając tablicę bez zmian.
+#define CREATE(array, size, on_error) do { \
+	void* helper = memory_alloc(size); \
+	if (helper == NULL) on_error; \
+	array = helper; \
 } while (0)
 
-#define EXTEND(array, size) do { \
-	array = realloc(array, size); \
-	if (array == NULL) _Exit(1); \
+#define EXTEND(array, size, on_error) do { \
+	void* helper = memory_realloc(array, size); \
+	if (helper == NULL) on_error; \
+	array = helper; \
 } while (0)
 
 typedef struct {
@@ -45,37 +56,45 @@ static size_t id_count = 0, id_size = 1;
 static int32_t* which_list;
 static int32_t* position;
 
-// zwolnione numery zbiorów
-static size_t free_list_count = 0, free_list_size = 1;
+// zwolnione numery zbiorów (tablica ma rozmiar lists_size)
+static size_t free_list_count = 0;
 static int32_t* free_lists;
 
-// zwolnione identyfikatory
-static size_t free_id_count = 0, free_id_size = 1;
+// zwolnione identyfikatory (tablica ma rozmiar id_size)
+static size_t free_id_count = 0;
 static int32_t* free_ids;
 
-// inicjalizuje odpowiednie tablice
-void find_union_initialize(void) {
-	CREATE(free_lists, sizeof(int32_t) * free_list_size);
-	CREATE(free_ids, sizeof(int32_t) * free_id_size);
-	CREATE(which_list, sizeof(int32_t) * id_size);
-	CREATE(position, sizeof(int32_t) * id_size);
-	CREATE(lists, sizeof(IdentifierList) * lists_size);
+// Inicjalizuje odpowiednie tablice. Zwraca false, jeżeli zabrakło pamięci.
+bool find_union_initialize(void) {
+	CREATE(free_lists, sizeof(int32_t) * lists_size, return false);
+	CREATE(free_ids, sizeof(int32_t) * id_size, return false);
+	CREATE(which_list, sizeof(int32_t) * id_size, return false);
+	CREATE(position, sizeof(int32_t) * id_size, return false);
+	CREATE(lists, sizeof(IdentifierList) * lists_size, return false);
+	return true;
 }
 
-// Zwalnia całą pamięć zajmowaną przez strukturę.
+/* Zwalnia całą pamięć zajmowaną przez strukturę.
+ * Strukturę można potem zainicjalizować ponownie.
+ */
 void find_union_clear(void) {
-	free(which_list);
-	free(position);
-	free(free_lists);
-	free(free_ids);
+	memory_free(which_list);
+	memory_free(position);
+	memory_free(free_lists);
+	memory_free(free_ids);
 	for (size_t i = 0; i < lists_count; i++) {
-		free(lists[i].identifiers);
+		memory_free(lists[i].identifiers);
 	}
-	free(lists);
+	memory_free(lists);
+	
+	lists_count = free_list_count = 0;
+	id_count = free_id_count = 0;
+	lists_size = id_size = 1;
 }
 
 /* Tworzy nowy element i zwraca jego identyfikator.
  * Nie przypisuje jeszcze tego elementu do żadnego zbioru.
+ * Zwraca -1, jeżeli zabrakło pamięci.
  */
 int32_t get_identifier(void) {
 	int32_t id;
@@ -87,9 +106,11 @@ int32_t get_identifier(void) {
 	}
 	else {
 		if (id_count == id_size) {
-			id_size *= 2;
-			EXTEND(which_list, sizeof(int32_t) * id_size);
-			EXTEND(position, sizeof(int32_t) * id_size);
+			size_t new_size = 2 * id_size;
+			EXTEND(which_list, sizeof(int32_t) * new_size, return -1);
+			EXTEND(position, sizeof(int32_t) * new_size, return -1);
+			EXTEND(free_ids, sizeof(int32_t) * new_size, return -1);
+			id_size = new_size;
 		}
 		
 		id = id_count++;
@@ -105,13 +126,8 @@ int32_t get_identifier(void) {
 // Usuwa zbiór o danym numerze.
 // Numer zbioru zostaje dodany do stosu wolnych numerów zbiorów.
 void remove_list(int32_t list_id) {
-	free(lists[list_id].identifiers);
+	memory_free(lists[list_id].identifiers);
 	lists[list_id].identifiers = NULL;
-			
-	if (free_list_count == free_list_size) {
-		free_list_size *= 2;
-		EXTEND(free_lists, sizeof(int32_t) * free_list_size);
-	}
 	
 	free_lists[free_list_count++] = list_id;
 }
@@ -136,11 +152,6 @@ void remove_identifier(int32_t id) {
 		if (lists[my_list].count == 0) remove_list(my_list);
 	}
 	
-	if (free_id_count == free_id_size) {
-		free_id_size *= 2;
-		EXTEND(free_ids, sizeof(int32_t) * free_id_size);
-	}
-	
 	free_ids[free_id_count++] = id;
 }
 
@@ -153,26 +164,32 @@ uint64_t get_energy(int32_t id) {
 /* Ustawia energię elementu o zadanym identyfikatorze.
  * Jeżeli element nie miał dotąd przypisanego żadnego zbioru,
  * zostaje utworzony dla niego nowy jednoelementowy zbiór.
+ * Zwraca false, jeżeli zabrakło na to pamięci.
  */
-void set_energy(int32_t id, uint64_t energy) {
+bool set_energy(int32_t id, uint64_t energy) {
 	int32_t my_list = which_list[id];
 	
 	if (my_list == -1) {
+		if (free_list_count == 0 && lists_count == lists_size) {
+			size_t new_size = 2 * lists_size;
+			EXTEND(lists, sizeof(IdentifierList) * new_size, return false);
+			EXTEND(free_lists, sizeof(int32_t) * new_size, return false);
+			lists_size = new_size;
+		}
+		
+		int32_t* identifiers;
+		CREATE(identifiers, sizeof(int32_t), return false);
+		
 		if (free_list_count > 0) {
 			my_list = free_lists[--free_list_count];
 		}
 		else {
-			if (lists_count == lists_size) {
-				lists_size *= 2;
-				EXTEND(lists, sizeof(IdentifierList) * lists_size);
-			}
-			
 			my_list = lists_count++;
 		}
 		
 		lists[my_list].count = 1;
 		lists[my_list].size = 1;
-		CREATE(lists[my_list].identifiers, sizeof(int32_t) * lists[my_list].size);
+		lists[my_list].identifiers = identifiers;
 		
 		lists[my_list].identifiers[0] = id;
 		
@@ -181,21 +198,33 @@ void set_energy(int32_t id, uint64_t energy) {
 	}
 	
 	lists[my_list].energy = energy;
+	return true;
+}
+
+/* Zapewnia, że w liście o numerze list_id zmieści się co najmniej
+ * size elementów. Zwraca false, jeżeli zabrakło pamięci.
+ */
+static bool reserve(int32_t list_id, size_t size) {
+	IdentifierList* list = &lists[list_id];
+	if (list->size >= size) return true;
+	
+	size_t new_size = list->size;
+	while (new_size < size) new_size *= 2;
+	
+	EXTEND(list->identifiers, sizeof(int32_t) * new_size, return false);
+	list->size = new_size;
+	return true;
 }
 
 /* Funkcja dodaje element id do listy o numerze list_id.
  * Nie usuwa informacji o elemencie w poprzedniej liście.
+ * Zakłada, że w liście jest już na niego miejsce (zob. reserve()).
  */
 void add_to_list(int32_t list_id, int32_t id) {
 	which_list[id] = list_id;
 	IdentifierList* list = &lists[list_id];
 	position[id] = list->count;
 	
-	if (list->count == list->size) {
-		list->size *= 2;
-		EXTEND(list->identifiers, sizeof(int32_t) * list->size);
-	}
-	
 	list->identifiers[list->count++] = id;
 }
 
@@ -212,13 +241,16 @@ void swap(int32_t* a, int32_t* b) {
  * 
  * Funkcja działa na zasadzie przepisywania elementów z mniejszego zbioru
  * do większego, co pozwala zachować dobrą złożoność obliczeniową.
+ *
+ * Zwraca false (nie zmieniając zbiorów), jeżeli zabrakło pamięci.
  */
-void set_equal(int32_t id1, int32_t id2) {
+bool set_equal(int32_t id1, int32_t id2) {
 	if (which_list[id2] == -1) {
+		if (!reserve(which_list[id1], lists[which_list[id1]].count + 1)) return false;
 		add_to_list(which_list[id1], id2);
 	}
 	else {
-		if (which_list[id1] == which_list[id2]) return;
+		if (which_list[id1] == which_list[id2]) return true;
 		
 		int32_t list1 = which_list[id1], list2 = which_list[id2];
 		if (lists[list1].count < lists[list2].count) {
@@ -226,6 +258,8 @@ void set_equal(int32_t id1, int32_t id2) {
 			swap(&list1, &list2);
 		}
 		
+		if (!reserve(list1, lists[list1].count + lists[list2].count)) return false;
+		
 		// Liczenie średniej arytmetycznej w taki sposób zapobiega
 		// przekręceniu zmiennej przy przekroczeniu zakresu.
 		int32_t both_odd = 0;
@@ -238,4 +272,21 @@ void set_equal(int32_t id1, int32_t id2) {
 		
 		remove_list(list2);
 	}
+	
+	return true;
+}
+
+/* Zwraca liczbę elementów w zbiorze, do którego należy element id.
+ * Zakłada, że element ma już przydzielony zbiór.
+ */
+size_t get_class_size(int32_t id) {
+	return lists[which_list[id]].count;
+}
+
+/* Zwraca identyfikator elementu na pozycji index w zbiorze,
+ * do którego należy element id. Pozwala przejść po wszystkich
+ * elementach zbioru bez kopiowania go.
+ */
+int32_t get_class_member(int32_t id, size_t index) {
+	return lists[which_list[id]].identifiers[index];
 }
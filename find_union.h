@@ -1,9 +1,11 @@
 #ifndef _FIND_UNION_H_
 #define _FIND_UNION_H_
 
+#include <stddef.h>
+#include <stdbool.h>
 #include <inttypes.h>
 
-extern void find_union_initialize();
+extern bool find_union_initialize();
 
 extern void find_union_clear();
 
@@ -13,8 +15,12 @@ extern void remove_identifier(int32_t id);
 
 extern uint64_t get_energy(int32_t id);
 
-extern void set_energy(int32_t id, uint64_t energy);
+extern bool set_energy(int32_t id, uint64_t energy);
 
-extern void set_equal(int32_t id1, int32_t id2);
+extern bool set_equal(int32_t id1, int32_t id2);
+
+extern size_t get_class_size(int32_t id);
+
+extern int32_t get_class_member(int32_t id, size_t index);
 
 #endif /* _FIND_UNION_H_ */
@@ -0,0 +1,518 @@
+/* Testy różnicowe: porównanie programu z modelem wzorcowym (reference.c).
+ *
+ * LLVMFuzzerTestOneInput() wykonuje dane wejście jako ciąg poleceń
+ * w programie i w modelu, a następnie porównuje wyjścia (razem
+ * z komunikatami ERROR; odpowiedzi na MEMBERS z dokładnością do kolejności
+ * linii). Po każdym teście struktury są czyszczone i sprawdzane jest,
+ * czy została zwolniona cała pamięć. Przy rozbieżności program wypisuje
+ * wejście i oba wyjścia, po czym przerywa działanie (abort()).
+ *
+ * Wejście może się zaczynać od linii #bulk; linie do linii #end są wtedy
+ * wczytywane funkcją bulk_declare(), jak plik historii podany programowi.
+ *
+ * Każde wejście jest wykonywane dwa razy: bez limitu pamięci oraz
+ * z limitem wyliczonym z wejścia, polecenie po poleceniu. W drugim
+ * przebiegu polecenie przydzielające pamięć może się zakończyć błędem
+ * zamiast odpowiedzi modelu; model cofa wtedy to polecenie, a kolejne
+ * polecenia sprawdzają, czy stan programu również pozostał bez zmian.
+ * Zapytania muszą zawsze dawać odpowiedź modelu.
+ *
+ * make fuzz -- wersja dla libFuzzera (wymaga clang), np. ./fuzz katalog,
+ * make fuzz_random -- samodzielna wersja losująca ciągi poleceń:
+ * 		./fuzz_random [ziarno] [liczba testów],
+ * make fuzz_random_<rozmiar> -- to samo dla innego rozmiaru alfabetu.
+ * Wszystkie wersje są budowane z małymi NODES_IN_CHUNK, RELEASE_BATCH
+ * i LOAD_BUFFER_SIZE (zob. trie_tree.c).
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#include "commands.h"
+#include "parser.h"
+#include "trie_tree.h"
+#include "find_union.h"
+#include "memory.h"
+#include "io.h"
+#include "reference.h"
+#include "alphabet.h"
+
+typedef struct {
+	const char* text;
+	size_t len;
+} Line;
+
+static int compare_lines(const void* a, const void* b) {
+	const Line* line1 = a;
+	const Line* line2 = b;
+	size_t len = line1->len < line2->len ? line1->len : line2->len;
+	
+	int result = memcmp(line1->text, line2->text, len);
+	if (result != 0) return result;
+	return (line1->len > line2->len) - (line1->len < line2->len);
+}
+
+/* Dzieli tekst o długości len (zakończony znakiem końca linii) na linie
+ * i sortuje je. Zwraca tablicę linii, a w count zapisuje ich liczbę.
+ */
+static Line* sorted_lines(const char* text, size_t len, size_t* count) {
+	*count = 0;
+	for (size_t i = 0; i < len; i++) {
+		if (text[i] == '\n') (*count)++;
+	}
+	
+	Line* lines = malloc(sizeof(Line) * (*count + 1));
+	if (lines == NULL) abort();
+	
+	size_t start = 0, k = 0;
+	for (size_t i = 0; i < len; i++) {
+		if (text[i] != '\n') continue;
+		lines[k++] = (Line){ text + start, i - start };
+		start = i + 1;
+	}
+	
+	qsort(lines, *count, sizeof(Line), compare_lines);
+	return lines;
+}
+
+// Sprawdza, czy dwa fragmenty o długości len składają się z tych samych linii.
+static bool same_lines(const char* text1, const char* text2, size_t len) {
+	size_t count1, count2;
+	Line* lines1 = sorted_lines(text1, len, &count1);
+	Line* lines2 = sorted_lines(text2, len, &count2);
+	
+	bool result = count1 == count2;
+	for (size_t i = 0; result && i < count1; i++) {
+		result = compare_lines(&lines1[i], &lines2[i]) == 0;
+	}
+	
+	free(lines1);
+	free(lines2);
+	return result;
+}
+
+/* Porównuje wyjście programu (o długości len) z wyjściem modelu
+ * od pozycji from.
+ */
+static bool same_output(const char* result, size_t len, const ReferenceOutput* expected, size_t from) {
+	if (len != expected->len - from) return false;
+	if (len == 0) return true;
+	
+	const char* data = expected->data + from;
+	size_t pos = 0;
+	for (size_t i = 0; i < expected->unordered_count; i += 2) {
+		if (expected->unordered[i] < from) continue;
+		size_t begin = expected->unordered[i] - from, end = expected->unordered[i + 1] - from;
+		
+		if (memcmp(result + pos, data + pos, begin - pos) != 0) return false;
+		if (!same_lines(result + begin, data + begin, end - begin)) return false;
+		pos = end;
+	}
+	
+	return memcmp(result + pos, data + pos, len - pos) == 0;
+}
+
+// największy limit pamięci (ponad pamięć zajętą na początku) w drugim przebiegu
+#define MAX_BUDGET (1 << 15)
+
+// wejście bieżącego testu (do zgłaszania błędów)
+static const char* current_input;
+static size_t current_size;
+
+// limit pamięci w drugim przebiegu
+static size_t current_limit;
+
+static void report(const char* title, const char* data, size_t len) {
+	fprintf(stderr, "--- %s (%zu B)\n", title, len);
+	if (len > 0) fwrite(data, 1, len, stderr);
+	fprintf(stderr, "\n");
+}
+
+// Wypisuje wejście testu i oba wyjścia, po czym przerywa działanie.
+static void fail(const char* result, size_t len, const ReferenceOutput* expected, size_t from) {
+	report("wejście", current_input, current_size);
+	report("wyjście programu", result, len);
+	report("wyjście modelu", expected->data + from, expected->len - from);
+	abort();
+}
+
+/* Zwraca długość linii zaczynającej się na pozycji start tekstu o długości
+ * len, razem ze znakiem końca linii (ostatnia linia może go nie mieć).
+ */
+static size_t line_length(const char* text, size_t len, size_t start) {
+	const char* end = memchr(text + start, '\n', len - start);
+	return end == NULL ? len - start : (size_t)(end - (text + start)) + 1;
+}
+
+/* Wczytuje funkcją bulk_declare() plik historii o treści data i długości len.
+ * Dla pustej treści nic nie robi.
+ */
+static void load_file(const char* data, size_t len) {
+	if (len == 0) return;
+	
+	FILE* file = fmemopen((void*)data, len, "r");
+	if (file == NULL) abort();
+	bulk_declare(file);
+	fclose(file);
+}
+
+// Wczytuje do modelu plik historii o treści data i długości len.
+static void reference_load_file(const char* data, size_t len) {
+	for (size_t start = 0; start < len; ) {
+		size_t line_len = line_length(data, len, start);
+		bool newline = data[start + line_len - 1] == '\n';
+		
+		reference_bulk_declare(data + start, line_len - newline);
+		start += line_len;
+	}
+}
+
+/* Dzieli wejście na plik historii (file, file_len) i polecenia
+ * (commands, commands_len). Bez linii #bulk i #end plik jest pusty.
+ */
+static void split_input(const char* input, size_t size, const char** file, size_t* file_len,
+		const char** commands, size_t* commands_len) {
+	*file = input;
+	*file_len = 0;
+	*commands = input;
+	*commands_len = size;
+	
+	if (size < 6 || memcmp(input, "#bulk\n", 6) != 0) return;
+	
+	for (size_t start = 6; start < size; ) {
+		size_t line_len = line_length(input, size, start);
+		
+		if (line_len == 5 && memcmp(input + start, "#end\n", 5) == 0) {
+			*file = input + 6;
+			*file_len = start - 6;
+			*commands = input + start + line_len;
+			*commands_len = size - start - line_len;
+			return;
+		}
+		start += line_len;
+	}
+}
+
+// Wykonuje całe wejście bez limitu pamięci i porównuje wyjście z modelem.
+static void run_unlimited(const char* file, size_t file_len, const char* commands, size_t commands_len) {
+	io_use_memory(commands, commands_len);
+	load_file(file, file_len);
+	execute_commands();
+	
+	size_t len;
+	const char* result = io_memory_output(&len);
+	
+	reference_start();
+	reference_load_file(file, file_len);
+	for (size_t start = 0; start < commands_len; ) {
+		size_t line_len = line_length(commands, commands_len, start);
+		reference_execute(commands + start, line_len);
+		start += line_len;
+	}
+	ReferenceOutput expected = reference_finish();
+	
+	if (!same_output(result, len, &expected, 0)) fail(result, len, &expected, 0);
+	reference_output_free(&expected);
+}
+
+static bool starts_with(const char* line, size_t line_len, const char* prefix) {
+	size_t len = strlen(prefix);
+	return line_len >= len && memcmp(line, prefix, len) == 0;
+}
+
+/* Sprawdza, czy polecenie może się zakończyć błędem z powodu limitu
+ * pamięci: DECLARE, dwuparametrowe ENERGY i EQUAL (przydzielają trwałą
+ * pamięć) oraz MEMBERS (bufor na historie). Zapytania nie przydzielają
+ * pamięci, więc muszą się zgadzać z modelem.
+ */
+static bool may_fail(const char* line, size_t line_len) {
+	if (starts_with(line, line_len, "ENERGY ")) {
+		return memchr(line + 7, ' ', line_len - 7) != NULL;
+	}
+	return starts_with(line, line_len, "DECLARE ") || starts_with(line, line_len, "EQUAL ")
+			|| starts_with(line, line_len, "MEMBERS ");
+}
+
+/* Sprawdza wyjście programu na jeden krok (polecenie lub linię pliku
+ * historii, wtedy file == true) wykonany z limitem pamięci. Jeżeli różni
+ * się od wyjścia modelu od pozycji from, krok musiał móc się nie udać
+ * i zakończyć samym błędem, a model go cofa.
+ */
+static void check_step(const char* line, size_t line_len, size_t from, bool file) {
+	size_t len;
+	const char* result = io_memory_output(&len);
+	const ReferenceOutput* expected = reference_output();
+	
+	if (same_output(result, len, expected, from)) return;
+	
+	bool error = len == 6 && memcmp(result, "ERROR\n", 6) == 0;
+	if (error && (file || may_fail(line, line_len))) {
+		reference_restore();
+		return;
+	}
+	
+	fprintf(stderr, "limit pamięci: %zu B\n", current_limit);
+	report("krok", line, line_len);
+	fail(result, len, expected, from);
+}
+
+/* Wykonuje wejście z limitem pamięci większym o budget od pamięci zajętej
+ * na początku, krok po kroku, sprawdzając każdy krok z osobna.
+ * Linie pliku historii są wczytywane pojedynczo.
+ */
+static void run_with_budget(const char* file, size_t file_len, const char* commands, size_t commands_len,
+		size_t budget) {
+	current_limit = memory_used() + budget;
+	memory_set_limit(current_limit);
+	reference_start();
+	
+	for (size_t start = 0; start < file_len; ) {
+		size_t line_len = line_length(file, file_len, start);
+		
+		reference_save();
+		size_t from = reference_output()->len;
+		io_use_memory(NULL, 0);
+		load_file(file + start, line_len);
+		reference_load_file(file + start, line_len);
+		check_step(file + start, line_len, from, true);
+		
+		start += line_len;
+	}
+	
+	for (size_t start = 0; start < commands_len; ) {
+		size_t line_len = line_length(commands, commands_len, start);
+		
+		reference_save();
+		size_t from = reference_output()->len;
+		io_use_memory(commands + start, line_len);
+		execute_commands();
+		reference_execute(commands + start, line_len);
+		check_step(commands + start, line_len, from, false);
+		
+		start += line_len;
+	}
+	
+	memory_set_limit(0);
+	ReferenceOutput expected = reference_finish();
+	reference_output_free(&expected);
+}
+
+// Zwalnia struktury i sprawdza, czy została zwolniona cała pamięć.
+static void finish_run(void) {
+	io_finish();
+	trie_tree_clear();
+	parser_clear();
+	
+	if (memory_used() != 0) {
+		report("wejście", current_input, current_size);
+		fprintf(stderr, "niezwolniona pamięć: %zu B\n", memory_used());
+		abort();
+	}
+}
+
+// Wylicza z wejścia limit pamięci dla drugiego przebiegu (skrót FNV-1a).
+static size_t input_budget(const char* input, size_t size) {
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ (unsigned char)input[i]) * 1099511628211ULL;
+	}
+	return hash % MAX_BUDGET;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+	const char* input = (const char*)data;
+	current_input = input;
+	current_size = size;
+	
+	const char* file;
+	const char* commands;
+	size_t file_len, commands_len;
+	split_input(input, size, &file, &file_len, &commands, &commands_len);
+	
+	if (!find_union_initialize() || !parser_initialize()) abort();
+	run_unlimited(file, file_len, commands, commands_len);
+	finish_run();
+	
+	if (!find_union_initialize() || !parser_initialize()) abort();
+	run_with_budget(file, file_len, commands, commands_len, input_budget(input, size));
+	finish_run();
+	
+	return 0;
+}
+
+#ifndef LIBFUZZER
+
+// liczba poleceń w jednym losowym teście (co najwyżej)
+#define COMMANDS_IN_TEST 300
+
+// maksymalna długość losowej historii
+#define HISTORY_LENGTH 5
+
+// maksymalna długość rzadko losowanej długiej historii
+#define LONG_HISTORY_LENGTH 64
+
+// liczba linii losowego pliku historii (co najwyżej)
+#define LINES_IN_FILE 50
+
+/* Historie są budowane tylko z kilku symboli, aby często się powtarzały:
+ * z pierwszych i z ostatniego symbolu alfabetu.
+ */
+#define USED_SYMBOLS (ALPHABET_SIZE < 3 ? ALPHABET_SIZE : 3)
+
+static uint64_t random_state;
+
+// Generator xorshift64*.
+static uint64_t next_random(void) {
+	random_state ^= random_state >> 12;
+	random_state ^= random_state << 25;
+	random_state ^= random_state >> 27;
+	return random_state * 2685821657736338717ULL;
+}
+
+// Zwraca losową liczbę z przedziału [0, n).
+static size_t random_below(size_t n) {
+	return next_random() % n;
+}
+
+static char* test = NULL;
+static size_t test_len = 0, test_size = 0;
+
+static void append(const char* text) {
+	size_t len = strlen(text);
+	while (test_len + len > test_size) {
+		test_size = 2 * test_size + 64;
+		test = realloc(test, test_size);
+		if (test == NULL) abort();
+	}
+	memcpy(test + test_len, text, len);
+	test_len += len;
+}
+
+static void append_history(void) {
+	char history[LONG_HISTORY_LENGTH + 1];
+	size_t max_len = random_below(25) == 0 ? LONG_HISTORY_LENGTH : HISTORY_LENGTH;
+	size_t len = 1 + random_below(max_len);
+	
+	for (size_t i = 0; i < len; i++) {
+		size_t symbol = random_below(USED_SYMBOLS);
+		if (symbol == USED_SYMBOLS - 1) symbol = ALPHABET_SIZE - 1;
+		history[i] = SYMBOL_CHAR(symbol);
+	}
+	history[len] = 0;
+	
+	// Czasem historia zawiera niedozwolony znak.
+	if (random_below(100) == 0) history[random_below(len)] = 'x';
+	
+	append(history);
+}
+
+// Dopisuje energię, przede wszystkim wartości brzegowe; czasem niepoprawną.
+static void append_energy(void) {
+	static const char* special[] = {
+		"1", "2", "3", "18446744073709551615", "18446744073709551614", "0001"
+	};
+	static const char* wrong[] = { "0", "18446744073709551616", "-1", "1a", "" };
+	char buff[24];
+	
+	switch (random_below(40)) {
+		case 0:
+		append(wrong[random_below(sizeof(wrong) / sizeof(wrong[0]))]);
+		return;
+		
+		case 1: case 2: case 3: case 4: case 5:
+		case 6: case 7: case 8: case 9: case 10:
+		sprintf(buff, "%"PRIu64, next_random() | 1);
+		append(buff);
+		return;
+		
+		default:
+		append(special[random_below(sizeof(special) / sizeof(special[0]))]);
+	}
+}
+
+// Dopisuje niepoprawną (lub pustą czy komentarz) linię.
+static void append_malformed(void) {
+	static const char* lines[] = {
+		"", "# komentarz", "DECLARE", "DECLARE ", "DECLARE  0", "DECLARE 0 ",
+		"DECLARE0", "DECLAR 0", "DECLAREX 0", "declare 0", "DNERGY 0",
+		"ENERGY 0 ", "ENERGY 0  1", "ENERGY 0 1 ", "EQUAL 0", "EQUAL 0 1 2",
+		"EQUAL 0  1", "VALID 0\r", " VALID 0", "COUN 0", "MEMBER 0", "CLASSES 0"
+	};
+	append(lines[random_below(sizeof(lines) / sizeof(lines[0]))]);
+}
+
+// Dopisuje plik historii: linie #bulk, historie (czasem puste linie) i #end.
+static void append_file(void) {
+	size_t lines = random_below(LINES_IN_FILE + 1);
+	append("#bulk\n");
+	
+	for (size_t i = 0; i < lines; i++) {
+		if (random_below(20) > 0) append_history();
+		append("\n");
+	}
+	append("#end\n");
+}
+
+/* Losuje jeden test: czasem plik historii, a potem ciąg poleceń,
+ * z których większość jest poprawna.
+ */
+static void generate_test(void) {
+	static const char* one_argument[] = {
+		"DECLARE ", "DECLARE ", "DECLARE ", "REMOVE ", "VALID ", "ENERGY ",
+		"COUNT ", "STATS ", "CLASS ", "MEMBERS "
+	};
+	size_t commands = 1 + random_below(COMMANDS_IN_TEST);
+	test_len = 0;
+	
+	if (random_below(4) == 0) append_file();
+	
+	for (size_t i = 0; i < commands; i++) {
+		size_t kind = random_below(20);
+		
+		if (kind == 0) {
+			append_malformed();
+		}
+		else if (kind <= 4) {
+			append("EQUAL ");
+			append_history();
+			append(" ");
+			append_history();
+		}
+		else if (kind <= 8) {
+			append("ENERGY ");
+			append_history();
+			append(" ");
+			append_energy();
+		}
+		else {
+			append(one_argument[random_below(sizeof(one_argument) / sizeof(one_argument[0]))]);
+			append_history();
+		}
+		
+		// Ostatnia linia czasem nie ma znaku końca linii.
+		if (i + 1 < commands || random_below(10) > 0) append("\n");
+	}
+}
+
+int main(int argc, char* argv[]) {
+	uint64_t seed = argc > 1 ? strtoull(argv[1], NULL, 10) : 1;
+	unsigned long tests = argc > 2 ? strtoul(argv[2], NULL, 10) : 1000;
+	
+	for (unsigned long i = 0; i < tests; i++) {
+		// Każdy test ma własne ziarno, aby można go było powtórzyć.
+		random_state = (seed + i) * 0x9E3779B97F4A7C15ULL | 1;
+		generate_test();
+		LLVMFuzzerTestOneInput((const uint8_t*)test, test_len);
+	}
+	
+	free(test);
+	printf("OK: %lu testów\n", tests);
+	return 0;
+}
+
+#endif /* LIBFUZZER */
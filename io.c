@@ -0,0 +1,546 @@
+/* Wejście i wyjście programu. Standardowe wejście jest czytane dużymi
+ * blokami, z których parser pobiera kolejne znaki, a wyjście jest zbierane
+ * w buforach i zapisywane w całości.
+ *
+ * Jeżeli jądro udostępnia io_uring, odczyty kolejnych bloków są zlecane
+ * z wyprzedzeniem: parser czyta z bloku, który jest już gotowy, a następne
+ * są w tym czasie wczytywane. Ze zwykłego pliku czyta się naraz do wszystkich
+ * buforów, ze strumienia (np. potoku) -- do jednego bufora naprzód, aby dane
+ * nie zostały przestawione. Zapisy wyjścia również wykonują się
+ * asynchronicznie, gdy program zapełnia kolejny bufor.
+ *
+ * Jeżeli io_uring jest niedostępny (lub program skompilowano
+ * z -DNO_IO_URING), używane są zwykłe wywołania read i write.
+ *
+ * Przed czekaniem na dane wejściowe wyjście jest opróżniane, więc przy pracy
+ * interaktywnej odpowiedzi pojawiają się od razu.
+ *
+ * Na potrzeby testów (zob. fuzz.c) wejście można podać jako tablicę
+ * w pamięci (io_use_memory()). Wyjście, razem z komunikatami o błędach,
+ * jest wtedy zbierane w pamięci zamiast zapisywania.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "io.h"
+
+#if !defined(NO_IO_URING) && defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define USE_IO_URING
+#endif
+#endif
+
+#ifdef USE_IO_URING
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+/* Bufory są statyczne i nie przechodzą przez memory.c, więc nie są
+ * wliczane do limitu pamięci -- stanowią stały narzut (zob. quantization.c).
+ */
+
+// liczba i rozmiar buforów wejścia
+#define INPUT_BUFFERS 4
+#define INPUT_BUFFER_SIZE (1 << 20)
+
+// liczba i rozmiar buforów wyjścia
+#define OUTPUT_BUFFERS 2
+#define OUTPUT_BUFFER_SIZE (1 << 16)
+
+// liczba wpisów w kolejce io_uring (wystarcza na wszystkie bufory naraz)
+#define RING_ENTRIES 8
+
+typedef enum {
+	BUFFER_FREE,
+	BUFFER_READING,
+	BUFFER_READY
+} BufferState;
+
+/* Bufor wejścia.
+ * offset -- pozycja w pliku, od której jest czytany (-1 dla strumieni),
+ * result -- wynik odczytu: liczba bajtów, 0 na końcu pliku
+ * lub ujemny kod błędu.
+ */
+typedef struct {
+	char data[INPUT_BUFFER_SIZE];
+	BufferState state;
+	int64_t offset;
+	int64_t result;
+} InputBuffer;
+
+/* Bufor wyjścia. Jeżeli writing jest ustawione, to zapis bufora
+ * został zlecony i jeszcze trwa; written -- liczba bajtów już zapisanych.
+ */
+typedef struct {
+	char data[OUTPUT_BUFFER_SIZE];
+	size_t len, written;
+	bool writing;
+} OutputBuffer;
+
+static InputBuffer input[INPUT_BUFFERS];
+static OutputBuffer output[OUTPUT_BUFFERS];
+
+// bufor wejścia, z którego czyta parser, i pozycja w nim
+static size_t current_input = INPUT_BUFFERS - 1;
+static const char* input_data = NULL;
+static size_t input_pos = 0, input_len = 0;
+static bool input_eof = false;
+
+// Czy wejście jest zwykłym plikiem, z którego można czytać kilka bloków naraz.
+static bool input_seekable = false;
+
+// pozycja w pliku następnego zlecanego odczytu i następnego bajtu dla parsera
+static int64_t next_offset = 0, expected_offset = 0;
+
+// bufor wyjścia, do którego trafiają kolejne znaki
+static size_t current_output = 0;
+
+static bool use_ring = false;
+
+// wyjście zbierane w pamięci (zob. io_use_memory())
+static bool use_memory = false;
+static char* memory_output = NULL;
+static size_t memory_output_len = 0, memory_output_size = 0;
+
+static void complete(uint64_t user_data, int64_t result);
+static void flush_output(void);
+
+#ifdef USE_IO_URING
+
+// Kolejki io_uring współdzielone z jądrem.
+static struct {
+	int fd;
+	unsigned* sq_tail;
+	unsigned* sq_mask;
+	unsigned* sq_array;
+	unsigned* cq_head;
+	unsigned* cq_tail;
+	unsigned* cq_mask;
+	struct io_uring_sqe* sqes;
+	struct io_uring_cqe* cqes;
+	void* sq_ring;
+	void* cq_ring;
+	size_t sq_ring_size, cq_ring_size, sqes_size;
+} ring;
+
+// Zwalnia kolejki io_uring (również częściowo utworzone).
+static void ring_close(void) {
+	if (ring.sqes != NULL) munmap(ring.sqes, ring.sqes_size);
+	if (ring.cq_ring != NULL && ring.cq_ring != ring.sq_ring) munmap(ring.cq_ring, ring.cq_ring_size);
+	if (ring.sq_ring != NULL) munmap(ring.sq_ring, ring.sq_ring_size);
+	close(ring.fd);
+}
+
+// Mapuje fragment kolejek io_uring. Zwraca NULL w razie błędu.
+static void* ring_map(size_t size, off_t offset) {
+	void* result = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			ring.fd, offset);
+	return result == MAP_FAILED ? NULL : result;
+}
+
+/* Tworzy kolejki io_uring. Zwraca false, jeżeli jądro ich nie udostępnia
+ * (lub nie obsługuje odczytów i zapisów od bieżącej pozycji w pliku).
+ */
+static bool ring_setup(void) {
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	
+	ring.fd = syscall(__NR_io_uring_setup, RING_ENTRIES, &params);
+	if (ring.fd < 0) return false;
+	
+	ring.sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring.cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	ring.sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	
+	bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+	if (single_mmap && ring.cq_ring_size > ring.sq_ring_size) {
+		ring.sq_ring_size = ring.cq_ring_size;
+	}
+	
+	ring.sq_ring = ring_map(ring.sq_ring_size, IORING_OFF_SQ_RING);
+	if (single_mmap) ring.cq_ring = ring.sq_ring;
+	else ring.cq_ring = ring_map(ring.cq_ring_size, IORING_OFF_CQ_RING);
+	ring.sqes = ring_map(ring.sqes_size, IORING_OFF_SQES);
+	
+	if (ring.sq_ring == NULL || ring.cq_ring == NULL || ring.sqes == NULL
+			|| !(params.features & IORING_FEAT_RW_CUR_POS)) {
+		ring_close();
+		return false;
+	}
+	
+	char* sq = ring.sq_ring;
+	char* cq = ring.cq_ring;
+	ring.sq_tail = (unsigned*)(sq + params.sq_off.tail);
+	ring.sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+	ring.sq_array = (unsigned*)(sq + params.sq_off.array);
+	ring.cq_head = (unsigned*)(cq + params.cq_off.head);
+	ring.cq_tail = (unsigned*)(cq + params.cq_off.tail);
+	ring.cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+	ring.cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+	
+	return true;
+}
+
+/* Zleca jądru odczyt lub zapis (opcode) len bajtów na deskryptorze fd
+ * od pozycji offset (-1 oznacza bieżącą pozycję).
+ * Wynik trafi do funkcji complete() razem z user_data.
+ */
+static void ring_submit(int opcode, int fd, void* data, size_t len, int64_t offset,
+		uint64_t user_data) {
+	unsigned tail = *ring.sq_tail;
+	unsigned index = tail & *ring.sq_mask;
+	
+	struct io_uring_sqe* sqe = &ring.sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = opcode;
+	sqe->fd = fd;
+	sqe->addr = (uint64_t)(uintptr_t)data;
+	sqe->len = len;
+	sqe->off = (uint64_t)offset;
+	sqe->user_data = user_data;
+	
+	ring.sq_array[index] = index;
+	__atomic_store_n(ring.sq_tail, tail + 1, __ATOMIC_RELEASE);
+	
+	// W kolejce jest zawsze miejsce, więc błąd oznacza awarię jądra.
+	while (syscall(__NR_io_uring_enter, ring.fd, 1, 0, 0, NULL, 0) < 0) {
+		if (errno != EINTR && errno != EAGAIN) _Exit(1);
+	}
+}
+
+// Czeka na zakończenie jednej zleconej operacji i przekazuje jej wynik.
+static void ring_wait(void) {
+	while (true) {
+		unsigned head = *ring.cq_head;
+		unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+		
+		if (head != tail) {
+			struct io_uring_cqe* cqe = &ring.cqes[head & *ring.cq_mask];
+			uint64_t user_data = cqe->user_data;
+			int64_t result = cqe->res;
+			__atomic_store_n(ring.cq_head, head + 1, __ATOMIC_RELEASE);
+			
+			complete(user_data, result);
+			return;
+		}
+		
+		if (syscall(__NR_io_uring_enter, ring.fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0
+				&& errno != EINTR) _Exit(1);
+	}
+}
+
+#endif /* USE_IO_URING */
+
+/* Czeka na zakończenie dowolnej zleconej operacji.
+ * Bez io_uring operacje kończą się od razu po zleceniu.
+ */
+static void wait_any(void) {
+#ifdef USE_IO_URING
+	if (use_ring) ring_wait();
+#endif
+}
+
+// Zleca odczyt do bufora wejścia o numerze index.
+static void start_read(size_t index) {
+	InputBuffer* buffer = &input[index];
+	buffer->state = BUFFER_READING;
+	buffer->offset = -1;
+	
+	if (input_seekable) {
+		buffer->offset = next_offset;
+		next_offset += INPUT_BUFFER_SIZE;
+	}
+
+#ifdef USE_IO_URING
+	if (use_ring) {
+		ring_submit(IORING_OP_READ, STDIN_FILENO, buffer->data, INPUT_BUFFER_SIZE,
+				buffer->offset, index);
+		return;
+	}
+#endif
+	
+	// Odczyt blokuje, więc najpierw wypisujemy dotychczasowe odpowiedzi.
+	flush_output();
+	ssize_t result = read(STDIN_FILENO, buffer->data, INPUT_BUFFER_SIZE);
+	complete(index, result < 0 ? -errno : result);
+}
+
+// Zleca zapis niezapisanej części bufora wyjścia o numerze index.
+static void start_write(size_t index) {
+	OutputBuffer* buffer = &output[index];
+	buffer->writing = true;
+	
+	if (use_memory) {
+		size_t len = buffer->len - buffer->written;
+		if (memory_output_len + len > memory_output_size) {
+			size_t new_size = 2 * memory_output_size + len;
+			char* helper = realloc(memory_output, new_size);
+			if (helper == NULL) _Exit(1);
+			memory_output = helper;
+			memory_output_size = new_size;
+		}
+		memcpy(memory_output + memory_output_len, buffer->data + buffer->written, len);
+		memory_output_len += len;
+		complete(INPUT_BUFFERS + index, len);
+		return;
+	}
+
+#ifdef USE_IO_URING
+	if (use_ring) {
+		ring_submit(IORING_OP_WRITE, STDOUT_FILENO, buffer->data + buffer->written,
+				buffer->len - buffer->written, -1, INPUT_BUFFERS + index);
+		return;
+	}
+#endif
+	
+	ssize_t result = write(STDOUT_FILENO, buffer->data + buffer->written,
+			buffer->len - buffer->written);
+	complete(INPUT_BUFFERS + index, result < 0 ? -errno : result);
+}
+
+/* Obsługuje zakończenie operacji. Numery od 0 do INPUT_BUFFERS - 1
+ * oznaczają odczyty do odpowiednich buforów wejścia, a kolejne -- zapisy
+ * buforów wyjścia. Niepełny zapis jest kontynuowany. Po błędzie zapisu
+ * dane są tracone, tak jak przy funkcjach z biblioteki stdio.h.
+ */
+static void complete(uint64_t user_data, int64_t result) {
+	if (user_data < INPUT_BUFFERS) {
+		input[user_data].result = result;
+		input[user_data].state = BUFFER_READY;
+		return;
+	}
+	
+	size_t index = user_data - INPUT_BUFFERS;
+	OutputBuffer* buffer = &output[index];
+	
+	if (result > 0) buffer->written += result;
+	if (result == -EINTR || (result > 0 && buffer->written < buffer->len)) {
+		start_write(index);
+		return;
+	}
+	
+	buffer->writing = false;
+	buffer->len = buffer->written = 0;
+}
+
+/* Zleca zapis bieżącego bufora wyjścia i przechodzi do następnego.
+ * Zapisy muszą następować po kolei, więc naraz trwa co najwyżej jeden.
+ */
+static void flush_output(void) {
+	if (output[current_output].len == 0) return;
+	
+	for (size_t i = 0; i < OUTPUT_BUFFERS; i++) {
+		while (output[i].writing) wait_any();
+	}
+	
+	start_write(current_output);
+	current_output = (current_output + 1) % OUTPUT_BUFFERS;
+}
+
+/* Zleca odczyty do wolnych buforów w kolejności, w jakiej parser
+ * będzie z nich czytał, zaczynając od bieżącego.
+ * Bez io_uring odczyt jest wykonywany dopiero wtedy,
+ * gdy potrzebny jest bieżący bufor.
+ */
+static void schedule_reads(void) {
+	for (size_t k = 0; k < INPUT_BUFFERS; k++) {
+		size_t index = (current_input + k) % INPUT_BUFFERS;
+		
+		if (input[index].state == BUFFER_READY) {
+			// Nie czytamy za końcem pliku ani po błędzie.
+			if (input[index].result <= 0) return;
+			continue;
+		}
+		if (input[index].state == BUFFER_READING) {
+			if (!input_seekable) return;
+			continue;
+		}
+		if (!use_ring && k > 0) return;
+		
+		start_read(index);
+		if (!input_seekable) return;
+	}
+}
+
+/* Odrzuca wszystkie bufory wczytane z wyprzedzeniem i ustawia dalsze odczyty
+ * na pozycję, od której czyta parser. Potrzebne po niepełnym odczycie
+ * ze zwykłego pliku lub po przerwanym odczycie.
+ */
+static void resync(void) {
+	for (size_t i = 0; i < INPUT_BUFFERS; i++) {
+		while (input[i].state == BUFFER_READING) wait_any();
+		input[i].state = BUFFER_FREE;
+	}
+	next_offset = expected_offset;
+}
+
+/* Przechodzi do następnego bufora wejścia, czekając w razie potrzeby
+ * na jego wczytanie. Zwraca false na końcu wejścia.
+ */
+static bool refill(void) {
+	if (input_eof) return false;
+	
+	input[current_input].state = BUFFER_FREE;
+	current_input = (current_input + 1) % INPUT_BUFFERS;
+	
+	while (true) {
+		schedule_reads();
+		
+		InputBuffer* buffer = &input[current_input];
+		if (buffer->state != BUFFER_READY) {
+			flush_output();
+			while (buffer->state != BUFFER_READY) wait_any();
+		}
+		
+		if (buffer->result == -EINTR || (input_seekable && buffer->offset != expected_offset)) {
+			resync();
+			continue;
+		}
+		
+		if (buffer->result <= 0) {
+			input_eof = true;
+			return false;
+		}
+		
+		input_data = buffer->data;
+		input_pos = 0;
+		input_len = buffer->result;
+		expected_offset += buffer->result;
+		
+		schedule_reads();
+		return true;
+	}
+}
+
+/* Inicjalizuje wejście i wyjście, wybierając io_uring, jeżeli jest dostępny.
+ * Odczyty kilku bloków naraz są możliwe tylko dla zwykłego pliku.
+ */
+void io_initialize(void) {
+#ifdef USE_IO_URING
+	use_ring = ring_setup();
+	
+	struct stat info;
+	if (use_ring && fstat(STDIN_FILENO, &info) == 0 && S_ISREG(info.st_mode)) {
+		off_t position = lseek(STDIN_FILENO, 0, SEEK_CUR);
+		if (position >= 0) {
+			input_seekable = true;
+			next_offset = expected_offset = position;
+		}
+	}
+#endif
+}
+
+/* Zapisuje całe wyjście i zwalnia zasoby.
+ * Funkcja ta jest wywoływana na koniec programu.
+ */
+void io_finish(void) {
+	flush_output();
+	for (size_t i = 0; i < OUTPUT_BUFFERS; i++) {
+		while (output[i].writing) wait_any();
+	}
+
+#ifdef USE_IO_URING
+	if (use_ring) ring_close();
+	use_ring = false;
+#endif
+	
+	if (use_memory) {
+		free(memory_output);
+		memory_output = NULL;
+		memory_output_len = memory_output_size = 0;
+		use_memory = false;
+	}
+}
+
+/* Ustawia jako wejście tablicę data o długości len (zamiast standardowego
+ * wejścia) i zaczyna zbierać wyjście w pamięci. Tablica musi istnieć
+ * do końca czytania. Zakończenie pracy z pamięcią -- io_finish().
+ */
+void io_use_memory(const char* data, size_t len) {
+	use_memory = true;
+	memory_output_len = 0;
+	
+	input_data = data;
+	input_pos = 0;
+	input_len = len;
+	input_eof = true;
+}
+
+/* Zwraca wyjście zebrane w pamięci od wywołania io_use_memory()
+ * i zapisuje w len jego długość. Wynik jest ważny do wywołania io_finish().
+ */
+const char* io_memory_output(size_t* len) {
+	flush_output();
+	*len = memory_output_len;
+	return memory_output;
+}
+
+// Zwraca kolejny znak wejścia lub EOF.
+int io_getchar(void) {
+	if (input_pos == input_len && !refill()) return EOF;
+	return (unsigned char)input_data[input_pos++];
+}
+
+// Zwraca do wejścia ostatnio przeczytany znak (tylko jeden).
+void io_ungetc(int ch) {
+	if (ch != EOF && input_pos > 0) input_pos--;
+}
+
+// Wypisuje len bajtów z tablicy data.
+void io_write(const char* data, size_t len) {
+	while (len > 0) {
+		OutputBuffer* buffer = &output[current_output];
+		size_t part = OUTPUT_BUFFER_SIZE - buffer->len;
+		if (part > len) part = len;
+		
+		memcpy(buffer->data + buffer->len, data, part);
+		buffer->len += part;
+		data += part;
+		len -= part;
+		
+		if (buffer->len == OUTPUT_BUFFER_SIZE) flush_output();
+	}
+}
+
+// Wypisuje jeden znak.
+void io_putchar(char ch) {
+	OutputBuffer* buffer = &output[current_output];
+	buffer->data[buffer->len++] = ch;
+	if (buffer->len == OUTPUT_BUFFER_SIZE) flush_output();
+}
+
+// Wypisuje napis i znak końca linii (tak jak puts).
+void io_puts(const char* text) {
+	io_write(text, strlen(text));
+	io_putchar('\n');
+}
+
+/* Zgłasza błąd, wypisując ERROR na wyjście diagnostyczne
+ * (przy pracy z pamięcią -- razem z resztą wyjścia).
+ */
+void io_error(void) {
+	if (use_memory) io_puts("ERROR");
+	else fprintf(stderr, "ERROR\n");
+}
+
+// Wypisuje liczbę dziesiętnie.
+void io_put_uint64(uint64_t value) {
+	char buff[20];
+	int pos = sizeof(buff);
+	
+	do {
+		buff[--pos] = '0' + value % 10;
+		value /= 10;
+	} while (value > 0);
+	
+	io_write(buff + pos, sizeof(buff) - pos);
+}
@@ -0,0 +1,29 @@
+#ifndef _IO_H_
+#define _IO_H_
+
+#include <stddef.h>
+#include <inttypes.h>
+
+extern void io_initialize(void);
+
+extern void io_finish(void);
+
+extern int io_getchar(void);
+
+extern void io_ungetc(int ch);
+
+extern void io_write(const char* data, size_t len);
+
+extern void io_putchar(char ch);
+
+extern void io_puts(const char* text);
+
+extern void io_put_uint64(uint64_t value);
+
+extern void io_error(void);
+
+extern void io_use_memory(const char* data, size_t len);
+
+extern const char* io_memory_output(size_t* len);
+
+#endif /* _IO_H_ */
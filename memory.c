@@ -0,0 +1,78 @@
+/* Warstwa przydzielania pamięci, przez którą przechodzą wszystkie
+ * alokacje programu. Zlicza zajętą pamięć i pozwala ograniczyć ją z góry:
+ * jeżeli alokacja przekroczyłaby limit, zwracany jest NULL (tak samo,
+ * jak przy braku pamięci), a moduły wywołujące zgłaszają wtedy błąd
+ * danego polecenia, zamiast kończyć program.
+ *
+ * Każdy blok jest poprzedzony nagłówkiem z jego rozmiarem, więc liczone są
+ * dokładnie bajty przekazane funkcji malloc (łącznie z nagłówkami).
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include "memory.h"
+
+typedef union {
+	size_t size;
+	max_align_t align;
+} Header;
+
+// limit pamięci w bajtach (0 oznacza brak limitu) i zajęta pamięć
+static size_t limit = 0, used = 0;
+
+// Czy można przydzielić dodatkowo extra bajtów, nie przekraczając limitu.
+static int fits(size_t extra) {
+	return limit == 0 || (used <= limit && extra <= limit - used);
+}
+
+// Ustawia limit pamięci w bajtach (0 oznacza brak limitu).
+void memory_set_limit(size_t new_limit) {
+	limit = new_limit;
+}
+
+// Zwraca liczbę zajętych bajtów.
+size_t memory_used(void) {
+	return used;
+}
+
+/* Przydziela blok co najmniej size bajtów.
+ * Zwraca NULL, jeżeli zabrakło pamięci lub zostałby przekroczony limit.
+ */
+void* memory_alloc(size_t size) {
+	size_t total = size + sizeof(Header);
+	if (total < size || !fits(total)) return NULL;
+	
+	Header* header = malloc(total);
+	if (header == NULL) return NULL;
+	
+	header->size = total;
+	used += total;
+	return header + 1;
+}
+
+/* Zmienia rozmiar bloku tak jak realloc. W razie niepowodzenia
+ * zwraca NULL, a dotychczasowy blok pozostaje nienaruszony.
+ */
+void* memory_realloc(void* ptr, size_t size) {
+	if (ptr == NULL) return memory_alloc(size);
+	
+	Header* header = (Header*)ptr - 1;
+	size_t old_total = header->size, total = size + sizeof(Header);
+	if (total < size || (total > old_total && !fits(total - old_total))) return NULL;
+	
+	header = realloc(header, total);
+	if (header == NULL) return NULL;
+	
+	header->size = total;
+	used = used - old_total + total;
+	return header + 1;
+}
+
+// Zwalnia blok przydzielony przez memory_alloc lub memory_realloc.
+void memory_free(void* ptr) {
+	if (ptr == NULL) return;
+	
+	Header* header = (Header*)ptr - 1;
+	used -= header->size;
+	free(header);
+}
@@ -0,0 +1,16 @@
+#ifndef _MEMORY_H_
+#define _MEMORY_H_
+
+#include <stddef.h>
+
+extern void memory_set_limit(size_t limit);
+
+extern size_t memory_used(void);
+
+extern void* memory_alloc(size_t size);
+
+extern void* memory_realloc(void* ptr, size_t size);
+
+extern void memory_free(void* ptr);
+
+#endif /* _MEMORY_H_ */
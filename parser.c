@@ -1,6 +1,15 @@
 /* Parser wejścia. Czyta po jednej linii wejścia, a następnie przekazuje
  * ją jako odpowiedni typ struktury (zdefiniowanej w pliku parser.h)
  * do dalszego przetworzenia przez program.
+ * Znaki wejścia pobiera z buforów modułu io.c.
+ *
+ * Historie są zapisywane we wspólnym buforze linii, przydzielanym raz
+ * (parser_initialize()) i powiększanym tylko wtedy, gdy linia się w nim
+ * nie mieści; nigdy nie jest zmniejszany. Z tego samego bufora korzysta
+ * bulk_declare(), więc każda historia w drzewie się w nim mieści.
+ * Dzięki temu zapytania nie przydzielają pamięci i nie kończą się błędem
+ * z powodu limitu: historię, której nie da się zapisać, parser wczytuje
+ * do końca i przekazuje jako NULL -- nie może jej być w drzewie.
  */
 
 #include <stdio.h>
@@ -12,6 +21,9 @@
 #include <inttypes.h>
 
 #include "parser.h"
+#include "alphabet.h"
+#include "memory.h"
+#include "io.h"
 
 // Pomocnicze makra.
 
@@ -24,30 +36,79 @@ do { \
 	else CALL_ERROR(EOF_ERROR); \
 } while(0)
 
-#define CHECK_HISTORY_ERROR(arg) \
+#define CHECK_HISTORY_ERROR(result) \
 do { \
-	if ((arg) == NULL) _Exit(1); \
-	if ((arg)[0] == 'F') { \
-		free(arg); \
-		CALL_ERROR(EOF_ERROR); \
-	} \
-	if ((arg)[0] == 'E') { \
-		free(arg); \
-		CHECK_ENDL(ERROR); \
-	} \
+	if ((result) == HISTORY_EOF) CALL_ERROR(EOF_ERROR); \
+	if ((result) == HISTORY_ERROR) CHECK_ENDL(ERROR); \
 } while(0)
 
-#define COMMANDS_COUNT 5
+// początkowy rozmiar bufora linii
+#define INITIAL_BUFFER_SIZE 64
+
+// wyniki funkcji read_history()
+typedef enum {
+	HISTORY_CORRECT,
+	HISTORY_TOO_LONG,
+	HISTORY_ERROR,
+	HISTORY_EOF
+} HistoryResult;
+
+// bufor linii (zob. parser_buffer())
+static char* buffer = NULL;
+static size_t buffer_size = 0;
+
+#define COMMANDS_COUNT 9
 
 static const char* commands[COMMANDS_COUNT] = {
 	"DECLARE",
 	"REMOVE",
 	"VALID",
 	"EQUAL",
-	"ENERGY"
+	"ENERGY",
+	"COUNT",
+	"STATS",
+	"CLASS",
+	"MEMBERS"
 };
 
-static const size_t command_length[COMMANDS_COUNT] = {7, 6, 5, 5, 6};
+static const size_t command_length[COMMANDS_COUNT] = {7, 6, 5, 5, 6, 5, 5, 5, 7};
+
+/* Przydziela bufor linii. Zwraca false, jeżeli zabrakło pamięci.
+ * Należy ją wywołać przed wczytaniem pierwszego polecenia (i przed
+ * bulk_declare()), aby zapytania działały także przy wyczerpanym limicie.
+ */
+bool parser_initialize(void) {
+	buffer = memory_alloc(INITIAL_BUFFER_SIZE);
+	if (buffer == NULL) return false;
+	
+	buffer_size = INITIAL_BUFFER_SIZE;
+	return true;
+}
+
+// Zwalnia bufor linii. Parser można potem zainicjalizować ponownie.
+void parser_clear(void) {
+	memory_free(buffer);
+	buffer = NULL;
+	buffer_size = 0;
+}
+
+/* Zwraca bufor linii o rozmiarze co najmniej size bajtów, w razie potrzeby
+ * go powiększając. Zwraca NULL, jeżeli zabrakło pamięci (bufor pozostaje
+ * wtedy bez zmian). Powiększenie unieważnia wcześniej zwrócone wskaźniki.
+ */
+char* parser_buffer(size_t size) {
+	if (size <= buffer_size) return buffer;
+	
+	size_t new_size = buffer_size;
+	while (new_size < size) new_size *= 2;
+	
+	char* helper = memory_realloc(buffer, new_size);
+	if (helper == NULL) return NULL;
+	
+	buffer = helper;
+	buffer_size = new_size;
+	return buffer;
+}
 
 /* Konstruktor dla polecenia (typ Command przekazywany dalej do obsłużenia w programie).
  * Jeżeli polecenie potrzebuje mniej niż dwóch argumentów,
@@ -78,7 +139,7 @@ static Command make_command_ll(CommandType command_name, char* arg1, uint64_t ar
 static bool read_until_endl(void) {
 	int ch;
 	do {
-		ch = getchar();
+		ch = io_getchar();
 		if (ch == '\n') return true;
 	} while (ch != EOF);
 	return false;
@@ -92,7 +153,7 @@ static bool read_until_endl(void) {
 static CommandType read_command_name(void) {
 	size_t current_command = 0, pos = 0;
 	while (true) {
-		int ch = getchar();
+		int ch = io_getchar();
 		
 		if (ch == EOF) {
 			if (pos == 0) return EOF_CORRECT;
@@ -116,11 +177,16 @@ static CommandType read_command_name(void) {
 			}
 		}
 		
+		// Kolejne polecenie musi mieć ten sam prefiks, co dotychczas wczytany.
+		size_t matched = current_command;
 		while (current_command < COMMANDS_COUNT && (pos >= command_length[current_command]
-				|| ch != commands[current_command][pos])) current_command++;
+				|| ch != commands[current_command][pos]
+				|| strncmp(commands[current_command], commands[matched], pos) != 0)) {
+			current_command++;
+		}
 		
 		if (current_command == COMMANDS_COUNT) {
-			if (ch == '\n') ungetc(ch, stdin);
+			if (ch == '\n') io_ungetc(ch);
 			return ERROR;
 		}
 		
@@ -128,63 +194,54 @@ static CommandType read_command_name(void) {
 	}
 }
 
-/* Funkcja czyta historię - ciąg składający się ze znaków '0' .. '3'
- * i zwraca ją jako łańcuch znaków (zakończony znakiem \0).
- * Argumentem funkcji jest oczekiwany znak za końcem historii.
- * Może to być ' ' lub '\n'. Jeżeli natomiast oczekiwany jest dowolny
- * z tych znaków, argumentem powinien być znak o kodzie 0. W tej sytuacji
- * znak ten zostanie również wstawiony na koniec historii.
- * 
- * Sygnalizowane błędy;
- * 	- zły typ znaku -> zostaje zwrócona historia zaczynająca się od 'E';
- * 		napotkany wtedy błędny znak zostaje zwrócony do strumienia,
- * 	- pusta historia -> tak samo, jak przy złym typie znaku
- *  - napotkany koniec pliku -> zostaje zwrócona historia zaczynająca się od 'F'
+/* Funkcja czyta historię - ciąg składający się z symboli alfabetu
+ * (zob. alphabet.h) - i zapisuje ją w buforze linii od pozycji start
+ * jako łańcuch znaków (zakończony znakiem \0), w którym symbole są zapisane
+ * w postaci zakodowanej. Argumentami end1 i end2 są dopuszczalne znaki
+ * za końcem historii (' ' lub '\n'); wczytany z nich zostaje zapisany w end.
+ *
+ * Zwraca:
+ * 	- HISTORY_CORRECT -- historia została zapisana,
+ * 	- HISTORY_TOO_LONG -- historia jest poprawna, ale zabrakło pamięci
+ * 		na powiększenie bufora; została wczytana do końca bez zapisywania,
+ * 	- HISTORY_ERROR -- zły typ znaku lub pusta historia; napotkany wtedy
+ * 		znak zostaje zwrócony do strumienia,
+ * 	- HISTORY_EOF -- napotkany koniec pliku.
  */
-static char* read_history(char end) {
-	char end1, end2;
-
-	if (end == 0) end1 = ' ', end2 = '\n';
-	else end1 = end2 = end;
-
-	size_t buff_size = 4, pos = 0;
-	char* buff = malloc(buff_size);
-	if (buff == NULL) _Exit(1);
-
-	int ch;
-
-	do {
-		ch = getchar();
-		if (ch == EOF) {
-			buff[0] = 'F';
-			return buff;
+static HistoryResult read_history(char end1, char end2, size_t start, char* end) {
+	size_t pos = start;
+	bool too_long = false;
+	
+	while (true) {
+		int ch = io_getchar();
+		if (ch == EOF) return HISTORY_EOF;
+		
+		if (ch == end1 || ch == end2) {
+			if (pos == start && !too_long) {
+				io_ungetc(ch);
+				return HISTORY_ERROR;
+			}
+			*end = ch;
+			if (too_long) return HISTORY_TOO_LONG;
+			
+			buffer[pos] = 0;
+			return HISTORY_CORRECT;
 		}
-
-		if ((ch < '0' || ch > '3') && ch != end1 && ch != end2) {
-			buff[0] = 'E';
-			ungetc(ch, stdin);
-			return buff;
+		
+		if (!IS_SYMBOL(ch)) {
+			io_ungetc(ch);
+			return HISTORY_ERROR;
 		}
-
-		if (pos + 1 == buff_size) {
-			buff_size *= 2;
-			buff = realloc(buff, buff_size);
-			if (buff == NULL) _Exit(1);
+		
+		if (too_long) continue;
+		
+		// Miejsce na ten symbol i na znak \0.
+		if (parser_buffer(pos + 2) == NULL) {
+			too_long = true;
+			continue;
 		}
-
-		buff[pos++] = ch;
-	} while (ch != end1 && ch != end2);
-	
-	if (pos == 1) {
-		ungetc(buff[0], stdin);
-		buff[0] = 'E';
-		return buff;
+		buffer[pos++] = ENCODE_SYMBOL(ch);
 	}
-	
-	if (end != 0) buff[pos-1] = 0;
-	else buff[pos] = 0;
-	
-	return buff;
 }
 
 /* Funkcja czyta z wejścia liczbę całkowitą z zakresu [1, 2^64 - 1].
@@ -209,10 +266,10 @@ static uint64_t read_ull(void) {
 	const int last_digit = '5';
 	int ch;
 	do {
-		ch = getchar();
+		ch = io_getchar();
 		if (!isdigit(ch)) {
 			if (ch == '\n') {
-				if (value == 0) ungetc(ch, stdin);
+				if (value == 0) io_ungetc(ch);
 				return value;
 			}
 			return 0;
@@ -240,50 +297,49 @@ Command read_line(void) {
 	if (type == ERROR) CHECK_ENDL(type);
 	if (type == NONE) CALL_ERROR(NONE);
 
-	char* arg1;
+	char end;
+	HistoryResult result;
 	
 	// Polecenie EQUAL.
 	if (type == EQUAL) {
-		arg1 = read_history(' ');
-		CHECK_HISTORY_ERROR(arg1);
-
-		char* arg2 = read_history('\n');
-		if (arg2 == NULL || arg2[0] == 'E' || arg2[0] == 'F') free(arg1);
-		CHECK_HISTORY_ERROR(arg2);
-
-		return make_command_s(type, arg1, arg2);
+		result = read_history(' ', ' ', 0, &end);
+		CHECK_HISTORY_ERROR(result);
+		
+		// Druga historia jest zapisywana za pierwszą.
+		bool first_stored = result == HISTORY_CORRECT;
+		size_t start = first_stored ? strlen(buffer) + 1 : 0;
+		
+		HistoryResult result2 = read_history('\n', '\n', start, &end);
+		CHECK_HISTORY_ERROR(result2);
+		
+		return make_command_s(type, first_stored ? buffer : NULL,
+				result2 == HISTORY_CORRECT ? buffer + start : NULL);
 	}
 	/* Ten przypadek obejmuje zarówno jedno-, jak i dwuparametrowe
 	 * polecenie ENERGY. Zostają one rozróżnione później, na podstawie
 	 * rodzaju białego znaku po wczytaniu pierwszego argumentu.
 	 */
 	else if (type == ENERGY_MOD) {
-		arg1 = read_history(0);
-		CHECK_HISTORY_ERROR(arg1);
-
-		int len = strlen(arg1);
-
-		if (arg1[len-1] == ' ') {
+		result = read_history(' ', '\n', 0, &end);
+		CHECK_HISTORY_ERROR(result);
+		
+		char* arg1 = result == HISTORY_CORRECT ? buffer : NULL;
+		
+		if (end == ' ') {
 			uint64_t arg2 = read_ull();
+			if (arg2 == 0) CHECK_ENDL(ERROR);
 			
-			if (arg2 == 0) {
-				free(arg1);
-				CHECK_ENDL(ERROR);
-			}
-
-			arg1[len-1] = 0;
 			return make_command_ll(ENERGY_MOD, arg1, arg2);
 		}
 		else {
-			arg1[len-1] = 0;
 			return make_command_s(ENERGY_CHK, arg1, NULL);
-		}	
+		}
 	}
 	// Wszystkie pozostałe rodzaje prawidłowych poleceń.
 	else {
-		arg1 = read_history('\n');
-		CHECK_HISTORY_ERROR(arg1);
-
-		return make_command_s(type, arg1, NULL);
+		result = read_history('\n', '\n', 0, &end);
+		CHECK_HISTORY_ERROR(result);
+		
+		return make_command_s(type, result == HISTORY_CORRECT ? buffer : NULL, NULL);
 	}
 }
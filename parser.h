@@ -2,6 +2,8 @@
 #define _PARSER_H_
 
 #include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
 
 typedef enum {
 	EOF_CORRECT,
@@ -13,9 +15,18 @@ typedef enum {
 	VALID,
 	EQUAL,
 	ENERGY_MOD,
+	COUNT,
+	STATS,
+	CLASS,
+	MEMBERS,
 	ENERGY_CHK
 } CommandType;
 
+/* Wczytane polecenie. Historie (arg1, arg2_s) wskazują na bufor linii
+ * parsera i są ważne do wczytania następnego polecenia. Historia NULL
+ * jest poprawna, ale zbyt długa, by ją zapisać w buforze -- dłuższa
+ * od każdej historii w drzewie (zob. parser.c).
+ */
 typedef struct { 
 	CommandType name;
 	char* arg1;
@@ -25,6 +36,12 @@ typedef struct {
 	};
 } Command;
 
+extern bool parser_initialize(void);
+
+extern void parser_clear(void);
+
+extern char* parser_buffer(size_t size);
+
 extern Command read_line();
 
 #endif /* _PARSER_H_ */
@@ -1,55 +1,68 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
 
-#include "parser.h"
 #include "trie_tree.h"
 #include "find_union.h"
+#include "memory.h"
+#include "io.h"
+#include "commands.h"
+#include "parser.h"
 
-int main(void) {
+/* Program można uruchomić z argumentami:
+ *  -m limit -- limit pamięci w bajtach; polecenia, które wymagałyby
+ *  		więcej pamięci, kończą się błędem (ERROR); limit obejmuje
+ *  		całą pamięć przydzielaną w trakcie działania, ale nie stałe
+ *  		bufory wejścia i wyjścia z io.c (4 * 1 MiB + 2 * 64 KiB),
+ *  		które należy doliczyć do zużycia każdej instancji programu;
+ *  		bufor linii parsera jest przydzielany przed wczytaniem pliku
+ *  		i poleceń, więc zapytania (VALID, ENERGY h, COUNT, STATS, CLASS)
+ *  		działają także przy wyczerpanym limicie,
+ *  plik -- historie z tego pliku (po jednej w linii, najlepiej posortowane)
+ *  		zostają dopuszczone przed wczytaniem pierwszego polecenia.
+ */
+int main(int argc, char* argv[]) {
+	const char* file_name = NULL;
+	
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+			i++;
+			char* end;
+			unsigned long long limit = strtoull(argv[i], &end, 10);
+			if (!isdigit((unsigned char)argv[i][0]) || *end != 0 || limit == 0 || limit > SIZE_MAX) {
+				fprintf(stderr, "ERROR\n");
+				return 1;
+			}
+			memory_set_limit(limit);
+		}
+		else {
+			file_name = argv[i];
+		}
+	}
+	
+	if (!find_union_initialize() || !parser_initialize()) {
+		fprintf(stderr, "ERROR\n");
+		return 1;
+	}
 	atexit(trie_tree_clear);
-	find_union_initialize();
+	atexit(parser_clear);
 	
-	while (true) {
-		Command command = read_line();
-		
-		switch (command.name) {
-			case EOF_ERROR:
-			fprintf(stderr, "ERROR\n");
-			return 0;
-			
-			case EOF_CORRECT:;
-			return 0;
-			
-			case ERROR:
+	io_initialize();
+	atexit(io_finish);
+	
+	if (file_name != NULL) {
+		FILE* file = fopen(file_name, "r");
+		if (file == NULL) {
 			fprintf(stderr, "ERROR\n");
-			break;
-			
-			case DECLARE:
-			declare(command.arg1);
-			break;
-			
-			case REMOVE:
-			Remove(command.arg1);
-			break;
-			
-			case VALID:
-			valid(command.arg1);
-			break;
-			
-			case ENERGY_CHK:
-			energy_chk(command.arg1);
-			break;
-			
-			case ENERGY_MOD:
-			energy_mod(command.arg1, command.arg2_ll);
-			break;
-			
-			case EQUAL:
-			equal(command.arg1, command.arg2_s);
-			break;
-			
-			case NONE: ;
+			return 1;
 		}
+		
+		bulk_declare(file);
+		fclose(file);
 	}
+	
+	execute_commands();
+	return 0;
 }
@@ -0,0 +1,421 @@
+/* Wzorcowy model programu do testów różnicowych (zob. fuzz.c).
+ *
+ * Model jest celowo jak najprostszy: dopuszczone historie są trzymane
+ * w jednej tablicy i przeszukiwane liniowo, a każda z nich pamięta numer
+ * swojej klasy energii. Zrównanie energii przenumerowuje całą klasę.
+ *
+ * Wejście jest podawane linia po linii (reference_execute()), a każda linia
+ * jest sprawdzana w całości (niezależnie od parsera, który czyta znak
+ * po znaku). Linia bez znaku końca linii na końcu wejścia jest błędem
+ * i kończy wykonywanie.
+ *
+ * Stan modelu można zapamiętać i przywrócić (reference_save(),
+ * reference_restore()), aby pominąć polecenie, które program odrzucił
+ * z powodu limitu pamięci.
+ *
+ * Nie jest modelowany limit pamięci -- w razie jej braku model przerywa
+ * program.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include "reference.h"
+#include "alphabet.h"
+
+typedef unsigned __int128 uint128_t;
+
+// Zapewnia miejsce na kolejny element tablicy (o count elementach i rozmiarze size).
+#define RESERVE(array, count, size) do { \
+	if ((count) == (size)) { \
+		(size) = 2 * (size) + 1; \
+		(array) = realloc((array), sizeof(*(array)) * (size)); \
+		if ((array) == NULL) abort(); \
+	} \
+} while (0)
+
+/* Dopuszczona historia. Wskazuje na fragment wejścia.
+ * energy_class -- numer klasy energii lub -1, jeżeli historia nie ma energii.
+ */
+typedef struct {
+	const char* history;
+	size_t len;
+	int32_t energy_class;
+} Entry;
+
+static Entry* entries = NULL;
+static size_t entries_count = 0, entries_size = 0;
+
+// energie klas (klasy nie są nigdy usuwane)
+static uint64_t* energies = NULL;
+static size_t classes_count = 0, classes_size = 0;
+
+static ReferenceOutput output;
+
+// stan zapamiętany przez reference_save()
+static Entry* saved_entries = NULL;
+static uint64_t* saved_energies = NULL;
+static size_t saved_entries_count = 0, saved_classes_count = 0;
+static size_t saved_output_len = 0, saved_unordered_count = 0;
+
+// Wypisuje len bajtów z tablicy data.
+static void put(const char* data, size_t len) {
+	while (output.len + len > output.size) {
+		output.size = 2 * output.size + 16;
+		output.data = realloc(output.data, output.size);
+		if (output.data == NULL) abort();
+	}
+	memcpy(output.data + output.len, data, len);
+	output.len += len;
+}
+
+static void put_error(void) {
+	put("ERROR\n", 6);
+}
+
+// Wypisuje liczbę dziesiętnie, a za nią znak end.
+static void put_number(uint128_t value, char end) {
+	char buff[41];
+	int pos = sizeof(buff);
+	buff[--pos] = end;
+	
+	do {
+		buff[--pos] = '0' + value % 10;
+		value /= 10;
+	} while (value > 0);
+	
+	put(buff + pos, sizeof(buff) - pos);
+}
+
+static bool is_history(const char* text, size_t len) {
+	if (len == 0) return false;
+	for (size_t i = 0; i < len; i++) {
+		if (!IS_SYMBOL(text[i])) return false;
+	}
+	return true;
+}
+
+/* Zamienia zapis dziesiętny na liczbę z zakresu [1, 2^64 - 1].
+ * Zwraca false, jeżeli zapis jest niepoprawny lub liczba spoza zakresu.
+ */
+static bool parse_energy(const char* text, size_t len, uint64_t* value) {
+	uint128_t result = 0;
+	if (len == 0) return false;
+	
+	for (size_t i = 0; i < len; i++) {
+		if (text[i] < '0' || text[i] > '9') return false;
+		result = 10 * result + (text[i] - '0');
+		if (result > UINT64_MAX) return false;
+	}
+	
+	*value = result;
+	return result > 0;
+}
+
+// Zwraca pozycję historii w tablicy entries lub -1, jeżeli nie jest dopuszczona.
+static ptrdiff_t find(const char* history, size_t len) {
+	for (size_t i = 0; i < entries_count; i++) {
+		if (entries[i].len == len && memcmp(entries[i].history, history, len) == 0) return i;
+	}
+	return -1;
+}
+
+// Sprawdza, czy history (o długości len) jest prefiksem historii entry.
+static bool has_prefix(const Entry* entry, const char* history, size_t len) {
+	return entry->len >= len && memcmp(entry->history, history, len) == 0;
+}
+
+// Dopuszcza historię i wszystkie jej prefiksy.
+static void add_history(const char* history, size_t len) {
+	for (size_t i = 1; i <= len; i++) {
+		if (find(history, i) != -1) continue;
+		
+		RESERVE(entries, entries_count, entries_size);
+		entries[entries_count++] = (Entry){ history, i, -1 };
+	}
+}
+
+static void declare(const char* history, size_t len) {
+	add_history(history, len);
+	put("OK\n", 3);
+}
+
+static void remove_history(const char* history, size_t len) {
+	size_t kept = 0;
+	for (size_t i = 0; i < entries_count; i++) {
+		if (!has_prefix(&entries[i], history, len)) entries[kept++] = entries[i];
+	}
+	entries_count = kept;
+	put("OK\n", 3);
+}
+
+static void valid(const char* history, size_t len) {
+	if (find(history, len) != -1) put("YES\n", 4);
+	else put("NO\n", 3);
+}
+
+static void energy_chk(const char* history, size_t len) {
+	ptrdiff_t i = find(history, len);
+	if (i == -1 || entries[i].energy_class == -1) {
+		put_error();
+		return;
+	}
+	put_number(energies[entries[i].energy_class], '\n');
+}
+
+static void energy_mod(const char* history, size_t len, uint64_t energy) {
+	ptrdiff_t i = find(history, len);
+	if (i == -1) {
+		put_error();
+		return;
+	}
+	
+	if (entries[i].energy_class == -1) {
+		RESERVE(energies, classes_count, classes_size);
+		entries[i].energy_class = classes_count++;
+	}
+	energies[entries[i].energy_class] = energy;
+	put("OK\n", 3);
+}
+
+static void equal(const char* history1, size_t len1, const char* history2, size_t len2) {
+	ptrdiff_t i = find(history1, len1), j = find(history2, len2);
+	if (i == -1 || j == -1) {
+		put_error();
+		return;
+	}
+	
+	int32_t class1 = entries[i].energy_class, class2 = entries[j].energy_class;
+	
+	if (i != j && class1 != class2) {
+		if (class1 == -1) {
+			entries[i].energy_class = class2;
+		}
+		else if (class2 == -1) {
+			entries[j].energy_class = class1;
+		}
+		else {
+			// średnia zaokrąglona w dół
+			energies[class1] = ((uint128_t)energies[class1] + energies[class2]) / 2;
+			for (size_t k = 0; k < entries_count; k++) {
+				if (entries[k].energy_class == class2) entries[k].energy_class = class1;
+			}
+		}
+	}
+	else if (i != j && class1 == -1) {
+		put_error();
+		return;
+	}
+	
+	put("OK\n", 3);
+}
+
+static void count(const char* history, size_t len) {
+	size_t result = 0;
+	for (size_t i = 0; i < entries_count; i++) {
+		if (has_prefix(&entries[i], history, len)) result++;
+	}
+	put_number(result, '\n');
+}
+
+static void stats(const char* history, size_t len) {
+	uint64_t min = UINT64_MAX, max = 0;
+	uint128_t sum = 0;
+	
+	for (size_t i = 0; i < entries_count; i++) {
+		if (!has_prefix(&entries[i], history, len) || entries[i].energy_class == -1) continue;
+		
+		uint64_t energy = energies[entries[i].energy_class];
+		if (energy < min) min = energy;
+		if (energy > max) max = energy;
+		sum += energy;
+	}
+	
+	if (find(history, len) == -1 || max == 0) {
+		put_error();
+		return;
+	}
+	
+	put_number(min, ' ');
+	put_number(max, ' ');
+	put_number(sum, '\n');
+}
+
+/* Obsługuje polecenia CLASS (members == false) i MEMBERS.
+ * Historie z klasy są wypisywane w kolejności z tablicy entries,
+ * a fragment wyjścia jest oznaczany jako nieuporządkowany.
+ * Listę kończy pusta linia.
+ */
+static void class_query(const char* history, size_t len, bool members) {
+	ptrdiff_t i = find(history, len);
+	if (i == -1 || entries[i].energy_class == -1) {
+		put_error();
+		return;
+	}
+	
+	int32_t energy_class = entries[i].energy_class;
+	size_t begin = output.len, size = 0;
+	
+	for (size_t k = 0; k < entries_count; k++) {
+		if (entries[k].energy_class != energy_class) continue;
+		
+		size++;
+		if (members) {
+			put(entries[k].history, entries[k].len);
+			put("\n", 1);
+		}
+	}
+	
+	if (!members) {
+		put_number(size, '\n');
+		return;
+	}
+	
+	RESERVE(output.unordered, output.unordered_count, output.unordered_size);
+	output.unordered[output.unordered_count++] = begin;
+	RESERVE(output.unordered, output.unordered_count, output.unordered_size);
+	output.unordered[output.unordered_count++] = output.len;
+	put("\n", 1);
+}
+
+static bool is_command(const char* name, size_t len, const char* command) {
+	return len == strlen(command) && memcmp(name, command, len) == 0;
+}
+
+/* Wykonuje jedną (niepustą) linię wejścia, bez znaku końca linii.
+ * Linia jest dzielona na pola oddzielone pojedynczymi spacjami.
+ */
+static void execute_line(const char* line, size_t len) {
+	const char* field[3];
+	size_t field_len[3], fields = 0;
+	
+	size_t start = 0;
+	for (size_t i = 0; i <= len; i++) {
+		if (i < len && line[i] != ' ') continue;
+		
+		if (fields == 3) {
+			put_error();
+			return;
+		}
+		field[fields] = line + start;
+		field_len[fields++] = i - start;
+		start = i + 1;
+	}
+	
+	const char* name = field[0];
+	size_t name_len = field_len[0];
+	
+	if (fields == 2 && is_history(field[1], field_len[1])) {
+		const char* history = field[1];
+		size_t history_len = field_len[1];
+		
+		if (is_command(name, name_len, "DECLARE")) declare(history, history_len);
+		else if (is_command(name, name_len, "REMOVE")) remove_history(history, history_len);
+		else if (is_command(name, name_len, "VALID")) valid(history, history_len);
+		else if (is_command(name, name_len, "ENERGY")) energy_chk(history, history_len);
+		else if (is_command(name, name_len, "COUNT")) count(history, history_len);
+		else if (is_command(name, name_len, "STATS")) stats(history, history_len);
+		else if (is_command(name, name_len, "CLASS")) class_query(history, history_len, false);
+		else if (is_command(name, name_len, "MEMBERS")) class_query(history, history_len, true);
+		else put_error();
+		return;
+	}
+	
+	if (fields == 3 && is_history(field[1], field_len[1])) {
+		uint64_t energy;
+		
+		if (is_command(name, name_len, "ENERGY") && parse_energy(field[2], field_len[2], &energy)) {
+			energy_mod(field[1], field_len[1], energy);
+			return;
+		}
+		if (is_command(name, name_len, "EQUAL") && is_history(field[2], field_len[2])) {
+			equal(field[1], field_len[1], field[2], field_len[2]);
+			return;
+		}
+	}
+	
+	put_error();
+}
+
+// Zaczyna pracę modelu od pustego zbioru historii i pustego wyjścia.
+void reference_start(void) {
+	output = (ReferenceOutput){ NULL, 0, 0, NULL, 0, 0 };
+	entries_count = classes_count = 0;
+}
+
+/* Wykonuje jedną linię wejścia o długości len, razem ze znakiem końca linii.
+ * Linia bez niego (ostatnia linia wejścia) jest błędem.
+ */
+void reference_execute(const char* line, size_t len) {
+	if (len == 0) return;
+	
+	if (line[len - 1] != '\n') {
+		put_error();
+		return;
+	}
+	
+	if (len > 1 && line[0] != '#') execute_line(line, len - 1);
+}
+
+/* Wczytuje jedną linię (bez znaku końca linii) pliku historii
+ * tak jak bulk_declare(): dopuszcza historię bez wypisywania odpowiedzi,
+ * pomija pustą linię, a dla niepoprawnej wypisuje ERROR.
+ */
+void reference_bulk_declare(const char* line, size_t len) {
+	if (len == 0) return;
+	
+	if (is_history(line, len)) add_history(line, len);
+	else put_error();
+}
+
+// Zapamiętuje stan modelu razem z długością wyjścia.
+void reference_save(void) {
+	free(saved_entries);
+	free(saved_energies);
+	saved_entries = malloc(sizeof(Entry) * entries_count + 1);
+	saved_energies = malloc(sizeof(uint64_t) * classes_count + 1);
+	if (saved_entries == NULL || saved_energies == NULL) abort();
+	
+	if (entries_count > 0) memcpy(saved_entries, entries, sizeof(Entry) * entries_count);
+	if (classes_count > 0) memcpy(saved_energies, energies, sizeof(uint64_t) * classes_count);
+	saved_entries_count = entries_count;
+	saved_classes_count = classes_count;
+	saved_output_len = output.len;
+	saved_unordered_count = output.unordered_count;
+}
+
+// Przywraca stan zapamiętany przez reference_save(), cofając też wyjście.
+void reference_restore(void) {
+	if (saved_entries_count > 0) memcpy(entries, saved_entries, sizeof(Entry) * saved_entries_count);
+	if (saved_classes_count > 0) memcpy(energies, saved_energies, sizeof(uint64_t) * saved_classes_count);
+	entries_count = saved_entries_count;
+	classes_count = saved_classes_count;
+	output.len = saved_output_len;
+	output.unordered_count = saved_unordered_count;
+}
+
+// Zwraca dotychczasowe wyjście modelu (ważne do następnego polecenia).
+const ReferenceOutput* reference_output(void) {
+	return &output;
+}
+
+/* Kończy pracę modelu i zwraca całe jego wyjście.
+ * Wynik należy zwolnić funkcją reference_output_free().
+ */
+ReferenceOutput reference_finish(void) {
+	free(entries);
+	free(energies);
+	free(saved_entries);
+	free(saved_energies);
+	entries = saved_entries = NULL;
+	energies = saved_energies = NULL;
+	entries_size = classes_size = 0;
+	
+	return output;
+}
+
+void reference_output_free(ReferenceOutput* result) {
+	free(result->data);
+	free(result->unordered);
+}
@@ -0,0 +1,34 @@
+#ifndef _REFERENCE_H_
+#define _REFERENCE_H_
+
+#include <stddef.h>
+
+/* Wyjście modelu wzorcowego.
+ * data -- wypisane odpowiedzi (razem z komunikatami ERROR), o długości len,
+ * unordered -- pary (początek, koniec) fragmentów data, w których kolejność
+ * linii jest dowolna (odpowiedzi na polecenie MEMBERS).
+ */
+typedef struct {
+	char* data;
+	size_t len, size;
+	size_t* unordered;
+	size_t unordered_count, unordered_size;
+} ReferenceOutput;
+
+extern void reference_start(void);
+
+extern void reference_execute(const char* line, size_t len);
+
+extern void reference_bulk_declare(const char* line, size_t len);
+
+extern void reference_save(void);
+
+extern void reference_restore(void);
+
+extern const ReferenceOutput* reference_output(void);
+
+extern ReferenceOutput reference_finish(void);
+
+extern void reference_output_free(ReferenceOutput* output);
+
+#endif /* _REFERENCE_H_ */
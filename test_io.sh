@@ -0,0 +1,41 @@
+# Sprawdza obsługę wejścia i wyjścia programu (zob. io.c) dla podanych
+# plików wykonywalnych, np.: bash test_io.sh ./quantization ./quantization_no_uring
+#  - przy pracy interaktywnej odpowiedzi muszą się pojawić przed końcem wejścia,
+#  - wyjście musi być takie samo dla wejścia z pliku i z potoku.
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+status=0
+
+for i in $(seq 1 20000); do
+	echo "DECLARE 0$((i % 4))$((i / 4 % 4))$((i / 16 % 4))"
+	echo "VALID 0$((i % 3))"
+	echo "ENERGY 0$((i % 4)) $i"
+done > "$dir/big.in"
+
+for program in "$@"; do
+	echo -n "Test $program: "
+	
+	mkfifo "$dir/fifo"
+	"$program" < "$dir/fifo" > "$dir/interactive.out" 2>/dev/null &
+	exec 3> "$dir/fifo"
+	printf 'DECLARE 0\nVALID 0\n' >&3
+	sleep 1
+	answer=$(cat "$dir/interactive.out")
+	exec 3>&-
+	wait
+	rm "$dir/fifo"
+	
+	"$program" < "$dir/big.in" > "$dir/file.out" 2>&1
+	cat "$dir/big.in" | "$program" > "$dir/pipe.out" 2>&1
+	
+	if [ "$answer" != $'OK\nYES' ]; then
+		echo "WRONG ANSWER (no interactive output)"
+		status=1
+	elif ! cmp -s "$dir/file.out" "$dir/pipe.out"; then
+		echo "WRONG ANSWER (file and pipe differ)"
+		status=1
+	else echo "OK"
+	fi
+done
+
+exit $status
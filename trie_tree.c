@@ -5,21 +5,93 @@
  * Przekazywane argumenty do funkcji powinny być poprawne składniowo
  * (tzn. historia powinna składać się z odpowiednich znaków i kończyć \0,
  * a energia powinna być dodatnią liczbą z odpowiedniego przedziału).
+ * Historie należą do parsera (bufor linii, zob. parser.c); historia NULL
+ * jest zbyt długa, by ją zapisać, więc na pewno nie ma jej w drzewie.
  *
  * Moduł obsługuje natomiast takie błędy, jak próba przypisania energii
  * do historii, która nie jest dopuszczona.
+ *
+ * Każdy wierzchołek przechowuje dodatkowo liczbę historii w swoim
+ * poddrzewie oraz liczbę tych z nich, które mają przypisaną energię.
+ * Obie zmieniają się tylko wzdłuż jednej ścieżki do korzenia, więc
+ * polecenie COUNT działa w czasie proporcjonalnym do długości prefiksu.
+ * Energie nie są agregowane, bo zmiana energii klasy (ENERGY, EQUAL)
+ * wymagałaby przeliczenia ścieżek wszystkich jej członków. Polecenie
+ * STATS nie działa więc w czasie proporcjonalnym do długości prefiksu:
+ * przechodzi poddrzewo, wchodząc tylko do tych jego części, w których są
+ * historie z energią, więc jego koszt to O(liczba historii z energią
+ * o danym prefiksie * długość ich ścieżek od prefiksu), a w najgorszym
+ * razie -- rozmiar poddrzewa.
+ *
+ * Tablica node_of_id pozwala przejść od identyfikatora w find and union
+ * do wierzchołka, a wskaźniki na ojców -- odtworzyć z wierzchołka historię.
+ * Korzystają z tego polecenia CLASS i MEMBERS.
+ *
+ * Wierzchołki są przydzielane z dużych, ciągłych bloków pamięci
+ * (zwolnione wierzchołki trafiają na listę wolnych i są używane ponownie),
+ * a cały plik posortowanych historii można wczytać jednym przebiegiem
+ * funkcją bulk_declare().
+ *
+ * Lista wolnych wierzchołków jest leniwa: usunięte poddrzewo trafia na nią
+ * w całości, w czasie stałym, a jego synowie są do niej dopisywani dopiero
+ * wtedy, gdy wierzchołek zostanie użyty ponownie (new_node()).
+ *
+ * Cała pamięć jest przydzielana przez moduł memory.c. Jeżeli jej zabraknie
+ * (lub zostałby przekroczony limit), polecenie kończy się błędem,
+ * a drzewo pozostaje w stanie sprzed jego wykonania.
+ *
+ * Poddrzewo usuwane poleceniem REMOVE jest od razu odłączane od drzewa.
+ * Identyfikatory historii z energią są z niego usuwane z find and union
+ * partiami, po RELEASE_BATCH wierzchołków na każde polecenie (również
+ * takie, które tylko odczytuje drzewo), więc zaległa praca nie rośnie
+ * przy samych zapytaniach. MEMBERS pomija członków klasy z usuniętych
+ * poddrzew (zob. attached()). Tylko CLASS, które musi znać dokładny
+ * rozmiar klasy, kończy najpierw całą zaległą pracę: w najgorszym razie,
+ * zaraz po usunięciu poddrzewa z k historiami z energią, trwa ono O(k).
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdbool.h>
 #include "trie_tree.h"
+#include "parser.h"
 #include "find_union.h"
+#include "alphabet.h"
+#include "memory.h"
+#include "io.h"
 
-#define ALPHABET_SIZE 4
+/* Poniższe stałe można zmienić przy kompilacji (-D); testy w fuzz.c
+ * używają małych wartości, aby często przechodzić przez granice bloków,
+ * bufora i partii.
+ */
+
+// liczba wierzchołków w jednym bloku pamięci
+#ifndef NODES_IN_CHUNK
+#define NODES_IN_CHUNK 4096
+#endif
+
+// rozmiar bufora do wczytywania pliku historii
+#ifndef LOAD_BUFFER_SIZE
+#define LOAD_BUFFER_SIZE (1 << 20)
+#endif
+
+// liczba wierzchołków usuniętych poddrzew zwalnianych przy jednym poleceniu
+#ifndef RELEASE_BATCH
+#define RELEASE_BATCH 4096
+#endif
+
+typedef unsigned __int128 uint128_t;
+
+// W razie braku pamięci wykonuje instrukcję on_error, pozostawiając tablicę bez zmian.
+#define EXTEND(array, size, on_error) do { \
+	void* helper = memory_realloc(array, size); \
+	if (helper == NULL) on_error; \
+	array = helper; \
+} while (0)
 
 #define CALL_ERROR do { \
-	fprintf(stderr, "ERROR\n"); \
+	io_error(); \
 	return; \
 } while (0)
 
@@ -28,22 +100,56 @@
  * jaka jest ścieżka od korzenia drzewa do niego.
  *
  * son[] -- tablica wskaźników na synów: son[0] odpowiada
- * za historię przedłużoną o '0' itd.
+ * za historię przedłużoną o '0' itd. (zob. alphabet.h).
  *
  * id -- identyfikator wierzchołka w find and union.
  * Jeżeli wierzchołek nie ma przypisanej energii,
  * to jego identyfikator jest równy -1.
  * W przeciwnym wypadku jest on pewną liczbą nieujemną.
+ *
+ * parent -- wskaźnik na ojca (NULL dla korzenia).
+ *
+ * count -- liczba wierzchołków w poddrzewie (wliczając ten wierzchołek).
+ *
+ * energized -- liczba wierzchołków poddrzewa z przypisaną energią.
  */
 struct Node {
 	struct Node* son[ALPHABET_SIZE];
+	struct Node* parent;
+	uint64_t count;
+	uint64_t energized;
 	int32_t id;
 };
 
 typedef struct Node Node;
 
 // korzeń drzewa
-static Node root = { { NULL, NULL, NULL, NULL }, -1 };
+static Node root = { .parent = NULL, .count = 1, .energized = 0, .id = -1 };
+
+/* Blok pamięci, z którego są przydzielane kolejne wierzchołki.
+ * Bloki tworzą listę, aby można je było zwolnić na koniec programu.
+ */
+typedef struct Chunk {
+	struct Chunk* next;
+	Node nodes[NODES_IN_CHUNK];
+} Chunk;
+
+static Chunk* chunks = NULL;
+static size_t chunk_used = NODES_IN_CHUNK;
+
+/* Lista wolnych poddrzew, połączona przez pola parent ich korzeni.
+ * Wierzchołki tych poddrzew nie mają identyfikatorów w find and union.
+ */
+static Node* free_nodes = NULL;
+
+/* Stos usuniętych poddrzew, w których są jeszcze identyfikatory
+ * do zwolnienia (zob. release_pending()), połączony przez pola parent.
+ */
+static Node* pending_nodes = NULL;
+
+// wierzchołki odpowiadające identyfikatorom z find and union
+static size_t node_of_id_size = 0;
+static Node** node_of_id = NULL;
 
 /* Zwraca wierzchołek w drzewie na głębokości len,
  * idąc po krawędziach odpowiadających historii (argument history).
@@ -54,7 +160,7 @@ Node* find_node(const char* history, int len) {
 	Node* current = &root;
 	
 	for (int i = 0; i < len; i++) {
-		int state = history[i] - '0';
+		int state = DECODE_SYMBOL(history[i]);
 		if (current->son[state] == NULL) return NULL;
 		current = current->son[state];
 	}
@@ -62,113 +168,320 @@ Node* find_node(const char* history, int len) {
 	return current;
 }
 
-/* Usuwa odpowiedni wierzchołek w drzewie i rekurencyjnie całe jego poddrzewo.
- * Jeżeli historia odpowiadająca wierzchołkowi miała przypisaną energię,
- * to odpowiednie informacje w strukturze find and union
- * również zostają usunięte.
+/* Zwraca wierzchołek odpowiadający całej historii lub NULL, jeżeli go nie ma.
+ * Historia NULL jest zbyt długa, by ją zapisać (zob. parser.h), więc nie ma
+ * jej w drzewie.
+ */
+static Node* find_history(const char* history) {
+	if (history == NULL) return NULL;
+	return find_node(history, strlen(history));
+}
+
+// Oddaje całe poddrzewo na listę wolnych wierzchołków.
+static void delete_subtree(Node* node) {
+	node->parent = free_nodes;
+	free_nodes = node;
+}
+
+static void release_pending(size_t limit);
+
+/* Zwraca nowy wierzchołek bez synów i energii, którego ojcem jest parent.
+ * Najpierw wykorzystuje wierzchołki zwolnione (synów wziętego wierzchołka
+ * dopisuje wtedy do listy wolnych), a dopiero gdy ich brakuje,
+ * bierze kolejny z bieżącego bloku (w razie potrzeby przydzielając nowy).
+ * Zwraca NULL, jeżeli zabrakło pamięci.
+ *
+ * Nowy blok jest przydzielany dopiero wtedy, gdy nie ma też usuniętych
+ * poddrzew czekających na zwolnienie identyfikatorów, więc to, czy polecenie
+ * zmieści się w limicie pamięci, zależy tylko od ciągu poleceń.
  */
-void erase(Node* to_erase) {
+static Node* new_node(Node* parent) {
+	Node* node;
+	
+	if (free_nodes == NULL && chunk_used == NODES_IN_CHUNK) release_pending(1);
+	
+	if (free_nodes != NULL) {
+		node = free_nodes;
+		free_nodes = node->parent;
+		
+		for (int i = 0; i < ALPHABET_SIZE; i++) {
+			if (node->son[i] != NULL) delete_subtree(node->son[i]);
+		}
+	}
+	else {
+		if (chunk_used == NODES_IN_CHUNK) {
+			Chunk* chunk = memory_alloc(sizeof(Chunk));
+			if (chunk == NULL) return NULL;
+			
+			chunk->next = chunks;
+			chunks = chunk;
+			chunk_used = 0;
+		}
+		node = &chunks->nodes[chunk_used++];
+	}
+	
+	memset(node->son, 0, sizeof(Node*) * ALPHABET_SIZE);
+	node->parent = parent;
+	node->id = -1;
+	node->count = 1;
+	node->energized = 0;
+	
+	return node;
+}
+
+/* Przelicza informacje o poddrzewie wierzchołka na podstawie
+ * jego własnej energii i informacji przechowywanych w synach.
+ */
+static void recalculate(Node* node) {
+	node->count = 1;
+	node->energized = node->id != -1;
+	
 	for (int i = 0; i < ALPHABET_SIZE; i++) {
-		if (to_erase->son[i] != NULL) erase(to_erase->son[i]);
+		Node* son = node->son[i];
+		if (son == NULL) continue;
+		
+		node->count += son->count;
+		node->energized += son->energized;
 	}
+}
+
+// Przelicza informacje o poddrzewach na ścieżce od wierzchołka do korzenia.
+static void update_path(Node* node) {
+	for (; node != NULL; node = node->parent) recalculate(node);
+}
+
+/* Przydziela wierzchołkowi nowy identyfikator w find and union.
+ * Zwraca false, jeżeli zabrakło pamięci.
+ */
+static bool assign_identifier(Node* node) {
+	int32_t id = get_identifier();
+	if (id == -1) return false;
 	
-	if (to_erase->id != -1) {
-		remove_identifier(to_erase->id);
+	if ((size_t)id >= node_of_id_size) {
+		size_t new_size = 2 * node_of_id_size + 1;
+		Node** helper = memory_realloc(node_of_id, sizeof(Node*) * new_size);
+		if (helper == NULL) {
+			remove_identifier(id);
+			return false;
+		}
+		node_of_id = helper;
+		node_of_id_size = new_size;
 	}
 	
-	free(to_erase);
+	node->id = id;
+	node_of_id[id] = node;
+	return true;
+}
+
+// Cofa przydzielenie identyfikatora wierzchołkowi.
+static void release_identifier(Node* node) {
+	remove_identifier(node->id);
+	node->id = -1;
+}
+
+// Wypisuje liczbę 128-bitową bez znaku.
+static void print_uint128(uint128_t value) {
+	char buff[40];
+	int pos = sizeof(buff);
+	
+	do {
+		buff[--pos] = '0' + value % 10;
+		value /= 10;
+	} while (value > 0);
+	
+	io_write(buff + pos, sizeof(buff) - pos);
+}
+
+/* Zwalnia identyfikatory w find and union co najwyżej limit wierzchołków
+ * z poddrzew czekających na to po poleceniu REMOVE i oddaje te wierzchołki
+ * na listę wolnych. Części poddrzew bez energii trafiają na listę wolnych
+ * od razu, w całości.
+ */
+static void release_pending(size_t limit) {
+	for (; limit > 0 && pending_nodes != NULL; limit--) {
+		Node* node = pending_nodes;
+		pending_nodes = node->parent;
+		
+		for (int i = 0; i < ALPHABET_SIZE; i++) {
+			Node* son = node->son[i];
+			if (son == NULL) continue;
+			
+			node->son[i] = NULL;
+			if (son->energized > 0) {
+				son->parent = pending_nodes;
+				pending_nodes = son;
+			}
+			else {
+				delete_subtree(son);
+			}
+		}
+		
+		if (node->id != -1) remove_identifier(node->id);
+		delete_subtree(node);
+	}
+}
+
+/* Usuwa poddrzewo odłączone już od drzewa. Bez energii trafia ono od razu
+ * na listę wolnych wierzchołków, a w przeciwnym wypadku -- na stos poddrzew,
+ * których identyfikatory są zwalniane partiami przez kolejne polecenia.
+ */
+static void erase_detached(Node* subtree) {
+	if (subtree->energized == 0) {
+		delete_subtree(subtree);
+		return;
+	}
+	
+	subtree->parent = pending_nodes;
+	pending_nodes = subtree;
 }
 
 /* Usuwa drzewo trie i zwraca zajmowaną przez nie pamięć.
  * Dodatkowo, wywołuje funkcję czyszczącą find and union.
- * Funkcja ta jest wywoływana na koniec programu.
+ * Wystarczy zwolnić całe bloki wierzchołków, bez przechodzenia drzewa.
+ * Po ponownym wywołaniu find_union_initialize() można zacząć od pustego
+ * drzewa (korzysta z tego fuzz.c).
  */
 void trie_tree_clear(void) {
-	for (int i = 0; i < ALPHABET_SIZE; i++) {
-		if (root.son[i] != NULL) erase(root.son[i]);
+	pending_nodes = NULL;
+	
+	while (chunks != NULL) {
+		Chunk* next = chunks->next;
+		memory_free(chunks);
+		chunks = next;
 	}
+	chunk_used = NODES_IN_CHUNK;
+	free_nodes = NULL;
+	
+	memory_free(node_of_id);
+	node_of_id = NULL;
+	node_of_id_size = 0;
 	find_union_clear();
+	
+	memset(root.son, 0, sizeof(root.son));
+	root.id = -1;
+	recalculate(&root);
 }
 
-// Obsługuje polecenie DECLARE.
+/* Obsługuje polecenie DECLARE.
+ * Jeżeli zabraknie pamięci, usuwa utworzone już wierzchołki i zgłasza błąd.
+ */
 void declare(char* history) {
+	release_pending(RELEASE_BATCH);
+	
+	// Historii, której parser nie zdołał zapisać, nie da się też dodać.
+	if (history == NULL) CALL_ERROR;
+	
 	int len = strlen(history);
 	Node* current = &root;
+	Node* first_created = NULL;
+	int first_state = 0;
 	
 	for (int i = 0; i < len; i++) {
-		int state = history[i] - '0';
+		int state = DECODE_SYMBOL(history[i]);
 		if (current->son[state] == NULL) {
-			current->son[state] = malloc(sizeof(Node));
-			if (current->son[state] == NULL) _Exit(1);
+			Node* son = new_node(current);
+			if (son == NULL) {
+				if (first_created != NULL) {
+					first_created->parent->son[first_state] = NULL;
+					delete_subtree(first_created);
+				}
+				CALL_ERROR;
+			}
 			
-			current->son[state]->id = -1;
-			memset(current->son[state]->son, 0, sizeof(Node*) * ALPHABET_SIZE);
+			current->son[state] = son;
+			if (first_created == NULL) {
+				first_created = son;
+				first_state = state;
+			}
 		}
 		current = current->son[state];
 	}
 	
-	free(history);
-	puts("OK");
+	if (first_created != NULL) update_path(current);
+	
+	io_puts("OK");
 }
 
 /* Obsługuje polecenie REMOVE.
  * Duża litera w nazwie funkcji, ponieważ mała pokrywałaby się z pewną funkcją z biblioteki stdio.h.
  */
 void Remove(char* history) {
+	release_pending(RELEASE_BATCH);
+	
+	// Zbyt długiej historii (NULL) nie ma w drzewie.
+	if (history == NULL) {
+		io_puts("OK");
+		return;
+	}
+	
 	int len = strlen(history);
 	Node* parent_of_erased = find_node(history, len - 1);
-	int last_state = history[len - 1] - '0';
-	
-	free(history);
+	int last_state = DECODE_SYMBOL(history[len - 1]);
 	
 	if (parent_of_erased != NULL && parent_of_erased->son[last_state] != NULL) {
-		erase(parent_of_erased->son[last_state]);
+		Node* erased = parent_of_erased->son[last_state];
 		parent_of_erased->son[last_state] = NULL;
+		update_path(parent_of_erased);
+		erase_detached(erased);
 	}
 	
-	puts("OK");
+	io_puts("OK");
 }
 
 // Obsługuje polecenie VALID.
 void valid(char* history) {
-	Node* node = find_node(history, strlen(history));
-	free(history);
+	release_pending(RELEASE_BATCH);
 	
-	if (node == NULL) puts("NO");
-	else puts("YES");	
+	Node* node = find_history(history);
+	
+	if (node == NULL) io_puts("NO");
+	else io_puts("YES");	
 }
 
 // Obsługuje jednoparametrowe polecenie ENERGY.
 void energy_chk(char* history) {
-	Node* node = find_node(history, strlen(history));
-	free(history);
+	release_pending(RELEASE_BATCH);
+	
+	Node* node = find_history(history);
 	
 	if (node == NULL || node->id == -1) CALL_ERROR;
 	
 	uint64_t energy = get_energy(node->id);
 	
-	if (energy > 0) printf("%"PRIu64"\n", energy);
-	else CALL_ERROR;
+	if (energy == 0) CALL_ERROR;
+	
+	io_put_uint64(energy);
+	io_putchar('\n');
 }
 
 // Obsługuje dwuparametrowe polecenie ENERGY.
 void energy_mod(char* history, uint64_t new_energy) {
-	Node* node = find_node(history, strlen(history));
-	free(history);
+	release_pending(RELEASE_BATCH);
+	
+	Node* node = find_history(history);
 	if (node == NULL) CALL_ERROR;
-	if (node->id == -1) node->id = get_identifier();
 	
-	set_energy(node->id, new_energy);
+	bool assigned = false;
+	if (node->id == -1) {
+		if (!assign_identifier(node)) CALL_ERROR;
+		assigned = true;
+	}
 	
-	puts("OK");
+	if (!set_energy(node->id, new_energy)) {
+		if (assigned) release_identifier(node);
+		CALL_ERROR;
+	}
+	if (assigned) update_path(node);
+	
+	io_puts("OK");
 }
 
 // Obsługuje polecenie EQUAL.
 void equal(char* history1, char* history2) {
-	Node* node1 = find_node(history1, strlen(history1));
-	Node* node2 = find_node(history2, strlen(history2));
-	free(history1);
-	free(history2);
+	release_pending(RELEASE_BATCH);
+	
+	Node* node1 = find_history(history1);
+	Node* node2 = find_history(history2);
 	
 	if (node1 == NULL || node2 == NULL) CALL_ERROR;
 	
@@ -180,10 +493,320 @@ void equal(char* history1, char* history2) {
 		}
 
 		if (node1->id == -1) CALL_ERROR;
-		if (node2->id == -1) node2->id = get_identifier();
 		
-		set_equal(node1->id, node2->id);
+		bool assigned = false;
+		if (node2->id == -1) {
+			if (!assign_identifier(node2)) CALL_ERROR;
+			assigned = true;
+		}
+		
+		if (!set_equal(node1->id, node2->id)) {
+			if (assigned) release_identifier(node2);
+			CALL_ERROR;
+		}
+		if (assigned) update_path(node2);
+	}
+	
+	io_puts("OK");
+}
+
+/* Obsługuje polecenie COUNT -- wypisuje liczbę dopuszczalnych historii,
+ * których prefiksem jest podana historia (wliczając ją samą).
+ */
+void count(char* history) {
+	release_pending(RELEASE_BATCH);
+	
+	Node* node = find_history(history);
+	
+	if (node == NULL) io_puts("0");
+	else {
+		io_put_uint64(node->count);
+		io_putchar('\n');
+	}
+}
+
+/* Zwraca pierwszego (od numeru from) syna wierzchołka, w którego poddrzewie
+ * są historie z energią, lub NULL, jeżeli takiego nie ma.
+ */
+static Node* energized_son(Node* node, int from) {
+	for (int i = from; i < ALPHABET_SIZE; i++) {
+		if (node->son[i] != NULL && node->son[i]->energized > 0) return node->son[i];
+	}
+	return NULL;
+}
+
+/* Uwzględnia w minimum, maksimum i sumie energie historii z poddrzewa
+ * wierzchołka top (który musi mieć historie z energią). Pomija poddrzewa
+ * bez energii, więc koszt zależy od liczby historii z energią, a nie
+ * od rozmiaru poddrzewa. Przechodzi drzewo bez rekurencji i bez stosu,
+ * wracając w górę po wskaźnikach na ojców, więc głębokość drzewa
+ * nie jest ograniczona rozmiarem stosu wywołań.
+ */
+static void collect_stats(Node* top, uint64_t* min, uint64_t* max, uint128_t* sum) {
+	Node* node = top;
+	
+	while (true) {
+		if (node->id != -1) {
+			uint64_t energy = get_energy(node->id);
+			if (energy < *min) *min = energy;
+			if (energy > *max) *max = energy;
+			*sum += energy;
+		}
+		
+		Node* next = energized_son(node, 0);
+		
+		// Powrót do najbliższego przodka, który ma jeszcze nieodwiedzonego syna z energią.
+		while (next == NULL && node != top) {
+			Node* parent = node->parent;
+			int state = 0;
+			while (parent->son[state] != node) state++;
+			
+			next = energized_son(parent, state + 1);
+			node = parent;
+		}
+		
+		if (next == NULL) return;
+		node = next;
+	}
+}
+
+/* Obsługuje polecenie STATS -- wypisuje minimum, maksimum i sumę energii
+ * historii z przypisaną energią, których prefiksem jest podana historia.
+ * Jeżeli żadna z nich nie ma energii, zgłasza błąd.
+ */
+void stats(char* history) {
+	release_pending(RELEASE_BATCH);
+	
+	Node* node = find_history(history);
+	
+	if (node == NULL || node->energized == 0) CALL_ERROR;
+	
+	uint64_t min = UINT64_MAX, max = 0;
+	uint128_t sum = 0;
+	collect_stats(node, &min, &max, &sum);
+	
+	io_put_uint64(min);
+	io_putchar(' ');
+	io_put_uint64(max);
+	io_putchar(' ');
+	print_uint128(sum);
+	io_putchar('\n');
+}
+
+/* Dodaje do ścieżki path (o długości path_len) wierzchołek node,
+ * w razie potrzeby powiększając tablicę.
+ * Zwraca false, jeżeli zabrakło pamięci.
+ */
+static bool push_path(Node*** path, size_t* path_len, size_t* path_size, Node* node) {
+	if (*path_len == *path_size) {
+		EXTEND(*path, sizeof(Node*) * 2 * *path_size, return false);
+		*path_size *= 2;
+	}
+	(*path)[(*path_len)++] = node;
+	return true;
+}
+
+/* Wczytuje z pliku historie (po jednej w linii) i dodaje je do drzewa
+ * tak jak polecenie DECLARE, ale bez wypisywania odpowiedzi.
+ * Dla błędnych linii, a także tych, dla których zabrakło pamięci,
+ * wypisuje ERROR na wyjście diagnostyczne. Puste linie pomija.
+ *
+ * Funkcja pamięta ścieżkę od korzenia do ostatnio dodanej historii.
+ * Kolejna historia schodzi tylko od końca wspólnego prefiksu z poprzednią,
+ * a informacje o poddrzewie wierzchołka są przeliczane raz, gdy schodzi on
+ * ze ścieżki. Dla posortowanego pliku każdy wierzchołek jest więc
+ * odwiedzany tylko raz. Nieposortowany plik również zostanie wczytany
+ * poprawnie, ale wolniej.
+ */
+void bulk_declare(FILE* file) {
+	size_t path_len = 1, path_size = 16;
+	Node** path = memory_alloc(sizeof(Node*) * path_size);
+	
+	// Historie są zapisywane we wspólnym buforze linii parsera (zob. parser.c).
+	size_t line_len = 0, line_size = 16;
+	char* line = parser_buffer(line_size);
+	// Jeden dodatkowy bajt na brakujący znak końca linii na końcu pliku.
+	char* buff = memory_alloc(LOAD_BUFFER_SIZE + 1);
+	
+	if (path == NULL || line == NULL || buff == NULL) {
+		memory_free(path);
+		memory_free(buff);
+		io_error();
+		return;
+	}
+	
+	path[0] = &root;
+	bool line_correct = true, eof = false;
+	
+	while (!eof) {
+		size_t read = fread(buff, 1, LOAD_BUFFER_SIZE, file);
+		if (read < LOAD_BUFFER_SIZE) {
+			eof = true;
+			buff[read++] = '\n';
+		}
+		
+		for (size_t i = 0; i < read; i++) {
+			char ch = buff[i];
+			
+			if (ch != '\n') {
+				if (!IS_SYMBOL(ch)) line_correct = false;
+				if (!line_correct) continue;
+				
+				// Bufor mieści historię razem ze znakiem \0 (zob. parser.h).
+				if (line_len + 1 == line_size) {
+					char* helper = parser_buffer(2 * line_size);
+					if (helper == NULL) {
+						line_correct = false;
+						continue;
+					}
+					line = helper;
+					line_size *= 2;
+				}
+				line[line_len++] = SYMBOL_INDEX(ch);
+				continue;
+			}
+			
+			if (!line_correct) io_error();
+			if (!line_correct || line_len == 0) {
+				line_correct = true;
+				line_len = 0;
+				continue;
+			}
+			
+			// Długość wspólnego prefiksu z poprzednią historią.
+			size_t common = 0;
+			while (common < line_len && common + 1 < path_len
+					&& path[common]->son[(int)line[common]] == path[common + 1]) common++;
+			
+			while (path_len > common + 1) recalculate(path[--path_len]);
+			
+			// Pozycja na ścieżce pierwszego utworzonego wierzchołka (0 -- brak).
+			size_t first_created = 0;
+			bool failed = false;
+			
+			for (size_t j = common; j < line_len && !failed; j++) {
+				Node* current = path[j];
+				if (current->son[(int)line[j]] == NULL) {
+					Node* son = new_node(current);
+					if (son == NULL) {
+						failed = true;
+						break;
+					}
+					current->son[(int)line[j]] = son;
+					if (first_created == 0) first_created = j + 1;
+				}
+				failed = !push_path(&path, &path_len, &path_size, current->son[(int)line[j]]);
+			}
+			
+			// Wycofanie wierzchołków utworzonych dla tej linii.
+			if (failed) {
+				io_error();
+				if (first_created > 0) {
+					Node* parent = path[first_created - 1];
+					int state = line[first_created - 1];
+					delete_subtree(parent->son[state]);
+					parent->son[state] = NULL;
+					if (path_len > first_created) path_len = first_created;
+				}
+			}
+			
+			line_len = 0;
+		}
+	}
+	
+	while (path_len > 0) recalculate(path[--path_len]);
+	
+	memory_free(buff);
+	memory_free(path);
+}
+
+/* Zapisuje do bufora historię odpowiadającą wierzchołkowi, zakończoną
+ * znakiem końca linii, i zwraca jej długość (wraz ze znakiem końca linii).
+ * Bufor musi mieć co najmniej głębokość wierzchołka + 1 bajtów.
+ */
+static size_t node_history(Node* node, char* buff) {
+	size_t len = 0;
+	
+	for (; node->parent != NULL; node = node->parent) {
+		int state = 0;
+		while (node->parent->son[state] != node) state++;
+		buff[len++] = SYMBOL_CHAR(state);
+	}
+	
+	for (size_t i = 0; i < len / 2; i++) {
+		char helper = buff[i];
+		buff[i] = buff[len - 1 - i];
+		buff[len - 1 - i] = helper;
+	}
+	buff[len++] = '\n';
+	
+	return len;
+}
+
+/* Sprawdza, czy wierzchołek jest w drzewie, a nie w usuniętym poddrzewie,
+ * którego identyfikatory czekają na zwolnienie, i zapisuje w depth jego
+ * głębokość. Korzeń takiego poddrzewa nie jest synem wierzchołka
+ * wskazywanego przez jego pole parent (które łączy stos poddrzew,
+ * zob. pending_nodes).
+ */
+static bool attached(Node* node, size_t* depth) {
+	*depth = 0;
+	for (; node->parent != NULL; node = node->parent) {
+		int state = 0;
+		while (state < ALPHABET_SIZE && node->parent->son[state] != node) state++;
+		if (state == ALPHABET_SIZE) return false;
+		(*depth)++;
+	}
+	
+	return node == &root;
+}
+
+/* Obsługuje polecenie CLASS -- wypisuje liczbę historii, których energia
+ * jest zrównana z energią podanej historii (wliczając ją samą).
+ */
+void class_size(char* history) {
+	release_pending(SIZE_MAX);
+	
+	Node* node = find_history(history);
+	
+	if (node == NULL || node->id == -1) CALL_ERROR;
+	
+	io_put_uint64(get_class_size(node->id));
+	io_putchar('\n');
+}
+
+/* Obsługuje polecenie MEMBERS -- wypisuje, po jednej w linii, wszystkie
+ * historie o energii zrównanej z energią podanej historii, z pominięciem
+ * historii z usuniętych poddrzew, a na końcu pustą linię (aby było wiadomo,
+ * gdzie kończy się lista).
+ * Historie są odtwarzane i wypisywane kolejno, bez kopiowania zbioru.
+ * Najpierw jest wyznaczana największa głębokość członka klasy i przydzielany
+ * bufor, więc jeżeli zabraknie pamięci, nic nie zostaje wypisane
+ * poza błędem.
+ */
+void class_members(char* history) {
+	release_pending(RELEASE_BATCH);
+	
+	Node* node = find_history(history);
+	
+	if (node == NULL || node->id == -1) CALL_ERROR;
+	
+	size_t size = get_class_size(node->id), max_depth = 0, depth;
+	for (size_t i = 0; i < size; i++) {
+		Node* member = node_of_id[get_class_member(node->id, i)];
+		if (attached(member, &depth) && depth > max_depth) max_depth = depth;
+	}
+	
+	char* buff = memory_alloc(max_depth + 1);
+	if (buff == NULL) CALL_ERROR;
+	
+	for (size_t i = 0; i < size; i++) {
+		Node* member = node_of_id[get_class_member(node->id, i)];
+		if (!attached(member, &depth)) continue;
+		
+		io_write(buff, node_history(member, buff));
 	}
+	io_putchar('\n');
 	
-	puts("OK");
+	memory_free(buff);
 }
@@ -1,12 +1,15 @@
 #ifndef _TRIETREE_H_
 #define _TRIETREE_H_
 
+#include <stdio.h>
 #include <inttypes.h>
 
 extern void trie_tree_clear();
 
 extern void declare(char* history);
 
+extern void bulk_declare(FILE* file);
+
 /* Duża litera, ponieważ funkcja o nazwie remove
  * znajduje się już w bibliotece stdio.h */
 extern void Remove(char* history);
@@ -19,4 +22,12 @@ extern void energy_mod(char* history, uint64_t energy);
 
 extern void equal(char* history1, char* history2);
 
+extern void count(char* history);
+
+extern void stats(char* history);
+
+extern void class_size(char* history);
+
+extern void class_members(char* history);
+
 #endif /* _TRIETREE_H_ */